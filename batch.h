@@ -0,0 +1,103 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <mutex>
+#include <vector>
+
+namespace KRAI {
+
+template <typename Sample> class BatchPool;
+
+// A batch of samples handed over by pointer from the batch former to the
+// device that runs it. The sample storage is reserved once at the pool's
+// batch capacity so refilling a recycled batch never allocates.
+template <typename Sample> struct Batch {
+  std::vector<Sample> samples;
+  BatchPool<Sample> *pool;
+
+  // Give the batch back to its pool once the device is done with it.
+  void release() { pool->release(this); }
+};
+
+// Recycles Batch objects. Starts with a fixed number of batches and only
+// allocates more if they are all in flight at once.
+template <typename Sample> class BatchPool {
+public:
+  BatchPool(int count, int capacity) : capacity(capacity) {
+    all.reserve(count);
+    free.reserve(count);
+    for (int i = 0; i < count; ++i)
+      free.push_back(create());
+  }
+
+  ~BatchPool() {
+    for (auto b : all)
+      delete b;
+  }
+
+  Batch<Sample> *acquire() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (free.empty())
+      return create();
+    Batch<Sample> *b = free.back();
+    free.pop_back();
+    return b;
+  }
+
+  void release(Batch<Sample> *b) {
+    b->samples.clear();
+    std::lock_guard<std::mutex> lock(mtx);
+    free.push_back(b);
+  }
+
+  // Number of batches ever created - anything above the initial count
+  // means the pool was too small for the work in flight.
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return all.size();
+  }
+
+private:
+  Batch<Sample> *create() {
+    Batch<Sample> *b = new Batch<Sample>;
+    b->samples.reserve(capacity);
+    b->pool = this;
+    all.push_back(b);
+    if (free.capacity() < all.size())
+      free.reserve(all.capacity());
+    return b;
+  }
+
+  const int capacity;
+  std::mutex mtx;
+  std::vector<Batch<Sample> *> all;
+  std::vector<Batch<Sample> *> free;
+};
+
+} // namespace KRAI
+
+#endif // BATCH_H
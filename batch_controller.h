@@ -0,0 +1,219 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef BATCH_CONTROLLER_H
+#define BATCH_CONTROLLER_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace KRAI {
+
+// Current choice of the adaptive batching controller and the estimates it
+// was based on.
+struct BatchingDecision {
+  int64_t max_wait_us;    // flush deadline for a partial batch
+  int expected_batch;     // batch size the deadline is expected to reach
+  double arrival_rate;    // samples per microsecond
+  double service_us;      // pessimistic device time for expected_batch
+  double overhead_us;     // pessimistic close to dispatch time
+};
+
+// Picks the partial batch flush deadline online. Estimates the sample
+// arrival rate and, per batch size, the time a batch spends on a device,
+// then chooses the longest wait (largest batch) for which
+//   wait + overhead + service(batch) <= latency target
+// still holds. Service and overhead estimates are mean + 3 * mean absolute
+// deviation, both as exponentially weighted moving averages, as a cheap
+// stand-in for the tail.
+class AdaptiveBatchController {
+public:
+  AdaptiveBatchController(int max_batch, int64_t target_us,
+                          int64_t max_wait_us)
+      : max_batch(max_batch), target_us(target_us), max_wait_us(max_wait_us),
+        service(max_batch + 1) {
+    decision = {max_wait_us, max_batch, 0.0, 0.0, 0.0};
+    window_start = std::chrono::steady_clock::now();
+  }
+
+  // Batch former only.
+  void recordArrivals(int n) { window_count += n; }
+
+  // Any thread - a batch of batch_size samples spent us on a device.
+  void recordService(int batch_size, int64_t us) {
+    if (batch_size < 1 || batch_size > max_batch)
+      return;
+    std::lock_guard<std::mutex> lock(mtx);
+    service[batch_size].update(us);
+  }
+
+  // Any thread - time from closing a batch to handing it to a device.
+  void recordOverhead(int64_t us) {
+    std::lock_guard<std::mutex> lock(mtx);
+    overhead.update(us);
+  }
+
+  // Batch former only - refresh the estimates and return the wait to use
+  // for the batch opened now.
+  int64_t update(std::chrono::time_point<std::chrono::steady_clock> now) {
+
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                          now - window_start)
+                          .count();
+    if (elapsed >= RATE_WINDOW_US) {
+      double rate = (double)window_count / elapsed;
+      arrival_rate = arrival_rate_valid
+                         ? arrival_rate + ALPHA * (rate - arrival_rate)
+                         : rate;
+      arrival_rate_valid = true;
+      window_count = 0;
+      window_start = now;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    BatchingDecision d = {max_wait_us, max_batch, arrival_rate, 0.0,
+                          overhead.pessimistic()};
+    ++updates;
+
+    if (!arrival_rate_valid || arrival_rate <= 0.0 || !haveService()) {
+      // nothing to go on yet
+      decision = d;
+      return d.max_wait_us;
+    }
+
+    // largest batch we can expect to fill and still serve in time
+    for (int k = max_batch; k >= 1; --k) {
+      double fill_us = (k - 1) / arrival_rate;
+      double service_us = serviceEstimate(k);
+      double budget = target_us - d.overhead_us - service_us;
+
+      if (fill_us <= budget || k == 1) {
+        double wait = budget;
+        // stop before a (k+1)-th sample is expected, its batch would not
+        // make it
+        if (k < max_batch && wait > k / arrival_rate)
+          wait = k / arrival_rate;
+        if (wait < 0)
+          wait = 0;
+        if (wait > max_wait_us)
+          wait = max_wait_us;
+
+        d.max_wait_us = (int64_t)wait;
+        d.expected_batch = k;
+        d.service_us = service_us;
+        break;
+      }
+    }
+
+    decision = d;
+    return d.max_wait_us;
+  }
+
+  BatchingDecision getDecision() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return decision;
+  }
+
+  void print() {
+    BatchingDecision d = getDecision();
+    std::cout << "Adaptive batching (target " << target_us
+              << "us): updates " << updates << " max wait " << d.max_wait_us
+              << "us expected batch " << d.expected_batch << " arrival rate "
+              << d.arrival_rate * 1e6 << "/s service " << d.service_us
+              << "us overhead " << d.overhead_us << "us" << std::endl;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    std::cout << "Service time by batch size (us): ";
+    for (int k = 1; k <= max_batch; ++k)
+      if (service[k].count)
+        std::cout << k << ":" << (int64_t)service[k].mean << " ";
+    std::cout << std::endl;
+  }
+
+private:
+  static constexpr double ALPHA = 0.1;
+  static const int64_t RATE_WINDOW_US = 1000;
+
+  struct Estimate {
+    double mean = 0.0;
+    double deviation = 0.0;
+    uint64_t count = 0;
+
+    void update(double v) {
+      if (count++ == 0) {
+        mean = v;
+        return;
+      }
+      double err = v - mean;
+      mean += ALPHA * err;
+      deviation += ALPHA * (std::fabs(err) - deviation);
+    }
+
+    double pessimistic() const { return mean + 3 * deviation; }
+  };
+
+  bool haveService() const {
+    for (int k = 1; k <= max_batch; ++k)
+      if (service[k].count)
+        return true;
+    return false;
+  }
+
+  // Sizes not seen yet borrow from the nearest larger size seen, or failing
+  // that the nearest smaller one, scaled linearly.
+  double serviceEstimate(int k) const {
+    for (int s = k; s <= max_batch; ++s)
+      if (service[s].count)
+        return service[s].pessimistic();
+    for (int s = k - 1; s >= 1; --s)
+      if (service[s].count)
+        return service[s].pessimistic() * k / s;
+    return 0.0;
+  }
+
+  const int max_batch;
+  const int64_t target_us;
+  const int64_t max_wait_us;
+
+  // arrival rate, owned by the batch former
+  std::chrono::time_point<std::chrono::steady_clock> window_start;
+  uint64_t window_count = 0;
+  double arrival_rate = 0.0;
+  bool arrival_rate_valid = false;
+
+  std::mutex mtx;
+  std::vector<Estimate> service;
+  Estimate overhead;
+  BatchingDecision decision;
+  uint64_t updates = 0;
+};
+
+} // namespace KRAI
+
+#endif // BATCH_CONTROLLER_H
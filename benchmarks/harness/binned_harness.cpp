@@ -173,11 +173,7 @@ public:
 
             kilt->LoadNextBatch(&bin);
             kilt->Inference(bin);
-            // int completed = 0;
-            // while (completed < bin.size()) {
-            //   completed = kilt->GetCompletedSampleCount();
-            //   std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            // }
+            kilt->WaitForCompletion();
           },
           i, bins[MAX_INPUT_LENGTHS[i]]);
 
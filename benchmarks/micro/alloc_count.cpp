@@ -0,0 +1,158 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Allocation count check: drives batches through the steady state hot path,
+// from the ingest queue through a pooled Batch and the device scheduler to
+// the payload and back to the pools, and fails if any of it allocates once
+// warmed up. Counts every global operator new.
+//
+//   g++ -O2 -std=c++17 -pthread -DKILT_CONFIG_FROM_ENV -DKILT_CONFIG_TRANSLATE_X -I../.. alloc_count.cpp -o alloc_count
+//   ./alloc_count [batches]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "device_scheduler.h"
+#include "mpsc_queue.h"
+#include "spsc_ring.h"
+
+using namespace KRAI;
+
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t size) {
+  ++allocations;
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct Sample {
+  uint64_t id;
+  uint64_t index;
+};
+
+struct Payload {
+  Batch<Sample> *batch;
+  std::chrono::time_point<std::chrono::steady_clock> enqueued;
+  int activation;
+  int set;
+};
+
+static const int batch_size = 8;
+
+// Stands in for the device side: the scheduler hands payloads over through
+// a ring, a device thread "runs" and releases them.
+struct FakeDevice {
+  SPSCRing<Payload *> running{64};
+  DeviceScheduler<Sample, Payload> *scheduler = nullptr;
+  std::atomic<uint64_t> completed{0};
+  std::atomic<bool> terminate{false};
+
+  static void Dispatch(void *handle, Payload *p) {
+    static_cast<FakeDevice *>(handle)->running.push(p);
+  }
+
+  void Run() {
+    Payload *p;
+    while (!terminate) {
+      if (!running.pop(p)) {
+        running.wait(1000, 0);
+        continue;
+      }
+      completed += p->batch->samples.size();
+      p->batch->release();
+      scheduler->Release(p);
+    }
+  }
+};
+
+int main(int argc, char *argv[]) {
+  int batches = argc > 1 ? atoi(argv[1]) : 100000;
+  const int warmup = 1000;
+
+  MPSCQueue<Sample> ingest(1024);
+  BatchPool<Sample> pool(64, batch_size);
+
+  FakeDevice device;
+  device.scheduler = new DeviceScheduler<Sample, Payload>(
+      2, 4, 16, 0, 0, &FakeDevice::Dispatch, &device);
+  device.scheduler->Start(-1);
+  std::thread device_thread(&FakeDevice::Run, &device);
+
+  Sample samples[batch_size];
+  uint64_t submitted = 0;
+  uint64_t before = 0;
+
+  for (int b = 0; b < warmup + batches; ++b) {
+    if (b == warmup) {
+      while (device.completed < submitted)
+        std::this_thread::yield();
+      before = allocations;
+    }
+
+    // ingest, then form a batch as the batch former does
+    for (int i = 0; i < batch_size; ++i)
+      samples[i] = {submitted + i, (uint64_t)i};
+    ingest.push(samples, batch_size);
+    submitted += batch_size;
+
+    Batch<Sample> *batch = pool.acquire();
+    batch->samples.resize(batch_size);
+    batch->samples.resize(ingest.pop(batch->samples.data(), batch_size));
+
+    while (device.scheduler->Push(batch) < 0)
+      std::this_thread::yield();
+  }
+
+  while (device.completed < submitted)
+    std::this_thread::yield();
+  uint64_t counted = allocations - before;
+
+  device.scheduler->Stop();
+  device.terminate = true;
+  device.running.wake();
+  device_thread.join();
+  delete device.scheduler;
+
+  printf("%d batches, %llu allocations in steady state, %zu batches in the "
+         "pool\n",
+         batches, (unsigned long long)counted, pool.size());
+  if (counted != 0) {
+    fprintf(stderr, "FAILED: the hot path allocates\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Copy kernel size sweep: bandwidth of memcpy/memset against the streaming
+// (non-temporal) kernels of the detected, or KILT_COPY_ISA forced, ISA from
+// 1KB to 256MB, and of copyData()/zeroData(), which switch between the two
+// at KILT_COPY_NT_THRESHOLD. The crossover is where the streaming column
+// overtakes the memcpy one; the threshold should sit close to it. Each size
+// is repeated over the same buffers, as staging reuses its buffers.
+//
+//   g++ -O2 -std=c++17 -DKILT_CONFIG_FROM_ENV -DKILT_CONFIG_TRANSLATE_X -I../.. copy_sweep.cpp -o copy_sweep
+//   ./copy_sweep [dest_offset]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "copy_kernels.h"
+
+using namespace KRAI;
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t max_size = 256 << 20;
+
+// GB/s of f over size bytes, repeated for about 1GB of traffic
+template <typename F> static double bandwidth(size_t size, F f) {
+  int reps = std::max<size_t>(3, (1 << 30) / size);
+  f(); // warm up, fault the pages in
+  auto t0 = Clock::now();
+  for (int r = 0; r < reps; ++r)
+    f();
+  double s = std::chrono::duration<double>(Clock::now() - t0).count();
+  return (double)size * reps / s / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+  size_t offset = argc > 1 ? atoi(argv[1]) : 0;
+
+  const CopyKernels &k = copyKernels();
+
+  uint8_t *src = static_cast<uint8_t *>(aligned_alloc(4096, max_size));
+  uint8_t *dst =
+      static_cast<uint8_t *>(aligned_alloc(4096, max_size + 4096));
+  memset(src, 1, max_size);
+  uint8_t *d = dst + offset;
+
+  printf("ISA %s, streaming from %zuKB, destination offset %zu\n",
+         copyIsaName(k.isa), k.nt_threshold / 1024, offset);
+  printf("%10s %10s %10s %10s %10s %10s %10s\n", "size", "memcpy", "stream",
+         "copyData", "memset", "stream", "zeroData");
+
+  for (size_t size = 1024; size <= max_size; size *= 2) {
+    double c_mem = bandwidth(size, [&] { memcpy(d, src, size); });
+    double c_nt = bandwidth(size, [&] { k.copy(d, src, size, true); });
+    double c_data = bandwidth(size, [&] { copyData(d, src, size); });
+    bool ok = memcmp(d, src, size) == 0;
+    double z_mem = bandwidth(size, [&] { memset(d, 0, size); });
+    double z_nt = bandwidth(size, [&] { k.zero(d, size, true); });
+    double z_data = bandwidth(size, [&] { zeroData(d, size); });
+    ok = ok && d[0] == 0 && memcmp(d, d + 1, size - 1) == 0;
+
+    if (!ok) {
+      fprintf(stderr, "FAILED: wrong data at %zu bytes\n", size);
+      return 1;
+    }
+
+    char label[32];
+    if (size >= 1 << 20)
+      snprintf(label, sizeof(label), "%zuMB", size >> 20);
+    else
+      snprintf(label, sizeof(label), "%zuKB", size >> 10);
+    printf("%10s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f%s\n", label,
+           c_mem, c_nt, c_data, z_mem, z_nt, z_data,
+           size >= k.nt_threshold && size / 2 < k.nt_threshold
+               ? "  <- threshold"
+               : "");
+  }
+
+  free(src);
+  free(dst);
+  return 0;
+}
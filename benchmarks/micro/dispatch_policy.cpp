@@ -0,0 +1,206 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Dispatch policy simulation: batches arrive at random (Poisson) and are
+// dispatched to a mix of fast and slow synthetic devices by each of the
+// KILT dispatch policies, in simulated time. Every device runs a fixed
+// number of batches at once and queues up to a fixed depth behind them; the
+// free queue slots are what the policies see, as GetFreeSlots() reports on
+// real devices. A full device makes the dispatcher retry after the yield
+// time, as Dispatch() does. Prints the batch latency (arrival to
+// completion) distribution per policy.
+//
+//   g++ -O2 -std=c++17 -I../.. dispatch_policy.cpp -o dispatch_policy
+//   ./dispatch_policy [load] [slow_factor] [devices] [batches]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <queue>
+#include <random>
+#include <vector>
+
+enum Policy { ROUND_ROBIN, LEAST_OUTSTANDING, POWER_OF_TWO };
+
+static const char *policy_names[] = {"ROUND_ROBIN", "LEAST_OUTSTANDING",
+                                     "POWER_OF_TWO"};
+
+struct Config {
+  double load = 0.8;        // of the total capacity of the devices
+  double slow_factor = 3.0; // service time of the slow half of the devices
+  int devices = 8;
+  int batches = 200000;
+  int activations = 2;      // batches a device runs at once
+  int queue_depth = 4;      // batches a device queues behind them
+  double service_us = 1000; // of a fast device
+  double jitter = 0.1;      // +- fraction of the service time
+  double yield_us = 10;     // dispatcher back-off when the device is full
+};
+
+struct SimDevice {
+  double service_us;
+  int running = 0;
+  std::deque<double> queued; // arrival times
+};
+
+struct Event {
+  double t;
+  int type; // 0 arrival, 1 completion, 2 dispatch retry
+  int device;
+  double arrived;
+  bool operator<(const Event &e) const { return t > e.t; }
+};
+
+static std::vector<double> simulate(const Config &cfg, Policy policy) {
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<double> uniform(0, 1);
+
+  std::vector<SimDevice> devices(cfg.devices);
+  double capacity = 0; // batches per us
+  for (int d = 0; d < cfg.devices; ++d) {
+    devices[d].service_us =
+        cfg.service_us * (d % 2 ? cfg.slow_factor : 1.0);
+    capacity += cfg.activations / devices[d].service_us;
+  }
+  std::exponential_distribution<double> interarrival(cfg.load * capacity);
+
+  std::priority_queue<Event> events;
+  std::deque<double> pending; // arrival times of batches not yet dispatched
+  bool retry_scheduled = false;
+  int round_robin = 0;
+  std::vector<double> latency;
+  latency.reserve(cfg.batches);
+
+  auto free_slots = [&](int d) {
+    return cfg.queue_depth - (int)devices[d].queued.size();
+  };
+
+  // mirrors KraiInferenceLibrary::SelectDevice()
+  auto select = [&]() {
+    const int n = cfg.devices;
+    int selected = round_robin;
+    if (policy == LEAST_OUTSTANDING) {
+      int best = free_slots(selected);
+      for (int i = 1; i < n; ++i) {
+        int idx = (round_robin + i) % n;
+        if (free_slots(idx) > best) {
+          best = free_slots(idx);
+          selected = idx;
+        }
+      }
+    } else if (policy == POWER_OF_TWO && n > 1) {
+      int a = rng() % n;
+      int b = rng() % (n - 1);
+      if (b >= a)
+        ++b;
+      selected = free_slots(b) > free_slots(a) ? b : a;
+    }
+    round_robin = (selected + 1) % n;
+    return selected;
+  };
+
+  auto start = [&](double now, int d) {
+    SimDevice &dev = devices[d];
+    while (dev.running < cfg.activations && !dev.queued.empty()) {
+      double us = dev.service_us *
+                  (1 + cfg.jitter * (2 * uniform(rng) - 1));
+      events.push({now + us, 1, d, dev.queued.front()});
+      dev.queued.pop_front();
+      ++dev.running;
+    }
+  };
+
+  // hands over pending batches in order until the selected device is full
+  auto dispatch = [&](double now) {
+    while (!pending.empty()) {
+      int d = select();
+      if (free_slots(d) <= 0) {
+        if (!retry_scheduled) {
+          events.push({now + cfg.yield_us, 2, -1, 0});
+          retry_scheduled = true;
+        }
+        return;
+      }
+      devices[d].queued.push_back(pending.front());
+      pending.pop_front();
+      start(now, d);
+    }
+  };
+
+  events.push({interarrival(rng), 0, -1, 0});
+  int arrived = 0;
+
+  while (!events.empty()) {
+    Event e = events.top();
+    events.pop();
+
+    if (e.type == 0) {
+      pending.push_back(e.t);
+      if (++arrived < cfg.batches)
+        events.push({e.t + interarrival(rng), 0, -1, 0});
+      if (!retry_scheduled)
+        dispatch(e.t);
+    } else if (e.type == 1) {
+      latency.push_back(e.t - e.arrived);
+      --devices[e.device].running;
+      start(e.t, e.device);
+    } else {
+      retry_scheduled = false;
+      dispatch(e.t);
+    }
+  }
+
+  std::sort(latency.begin(), latency.end());
+  return latency;
+}
+
+int main(int argc, char *argv[]) {
+  Config cfg;
+  if (argc > 1)
+    cfg.load = atof(argv[1]);
+  if (argc > 2)
+    cfg.slow_factor = atof(argv[2]);
+  if (argc > 3)
+    cfg.devices = std::max(1, atoi(argv[3]));
+  if (argc > 4)
+    cfg.batches = std::max(1, atoi(argv[4]));
+
+  printf("%d devices, every other one %.1fx slower, load %.2f, %d batches\n",
+         cfg.devices, cfg.slow_factor, cfg.load, cfg.batches);
+  printf("%-18s %10s %10s %10s %10s %10s\n", "policy", "mean us", "p50 us",
+         "p90 us", "p99 us", "p99.9 us");
+
+  for (Policy policy : {ROUND_ROBIN, LEAST_OUTSTANDING, POWER_OF_TWO}) {
+    std::vector<double> l = simulate(cfg, policy);
+    double sum = 0;
+    for (double v : l)
+      sum += v;
+    auto pct = [&](double p) { return l[std::min(l.size() - 1,
+                                                 (size_t)(p * l.size()))]; };
+    printf("%-18s %10.0f %10.0f %10.0f %10.0f %10.0f\n", policy_names[policy],
+           sum / l.size(), pct(0.5), pct(0.9), pct(0.99), pct(0.999));
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Ingest contention: 1 to 64 producer threads submit samples, one consumer
+// forms batches. Compares the lock-free MPSCQueue ingest path with the
+// previous one, where every sample took a shared mutex to be appended to the
+// open batch. The MPSC figures include the consumer thread, so on a machine
+// with fewer cores than producers both paths end up bound by scheduling.
+//
+//   g++ -O2 -std=c++17 -pthread -I../.. ingest_contention.cpp -o ingest_contention
+//   ./ingest_contention [samples_per_producer] [burst] [batch_size]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mpsc_queue.h"
+
+using namespace KRAI;
+
+struct Sample {
+  uint64_t id;
+  uint64_t index;
+};
+
+static int samples_per_producer = 200000;
+static int burst = 1;
+static int batch_size = 64;
+
+// The previous path: the open batch is a vector guarded by one mutex, the
+// producer that fills it closes it.
+class MutexIngest {
+public:
+  MutexIngest() { open.reserve(batch_size); }
+
+  void push(const Sample *s, int n) {
+    for (int i = 0; i < n; ++i) {
+      std::lock_guard<std::mutex> lock(mtx);
+      open.emplace_back(s[i]);
+      if ((int)open.size() == batch_size) {
+        closed += open.size();
+        open.clear();
+      }
+    }
+  }
+
+  uint64_t drain() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return closed + open.size();
+  }
+
+private:
+  std::mutex mtx;
+  std::vector<Sample> open;
+  uint64_t closed = 0;
+};
+
+template <typename Push>
+static double run(int producers, Push push, std::atomic<bool> &done) {
+  std::atomic<int> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> threads;
+
+  for (int p = 0; p < producers; ++p)
+    threads.emplace_back([&, p] {
+      std::vector<Sample> s(burst);
+      ++ready;
+      while (!go)
+        std::this_thread::yield();
+      for (int i = 0; i < samples_per_producer; i += burst) {
+        for (int b = 0; b < burst; ++b)
+          s[b] = {(uint64_t)p, (uint64_t)(i + b)};
+        push(s.data(), burst);
+      }
+    });
+
+  while (ready < producers)
+    std::this_thread::yield();
+  auto t0 = std::chrono::steady_clock::now();
+  go = true;
+  for (auto &t : threads)
+    t.join();
+  done = true;
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1)
+    samples_per_producer = atoi(argv[1]);
+  if (argc > 2)
+    burst = std::max(1, atoi(argv[2]));
+  if (argc > 3)
+    batch_size = std::max(1, atoi(argv[3]));
+  samples_per_producer = samples_per_producer / burst * burst;
+
+  printf("%d samples per producer, bursts of %d, batches of %d\n",
+         samples_per_producer, burst, batch_size);
+  printf("%10s %16s %16s %10s\n", "producers", "mutex ns/sample",
+         "mpsc ns/sample", "speedup");
+
+  for (int producers = 1; producers <= 64; producers *= 2) {
+    const uint64_t total = (uint64_t)producers * samples_per_producer;
+
+    MutexIngest mutex_ingest;
+    std::atomic<bool> mutex_done{false};
+    double mutex_ns = run(
+        producers,
+        [&](const Sample *s, int n) { mutex_ingest.push(s, n); }, mutex_done);
+    if (mutex_ingest.drain() != total) {
+      fprintf(stderr, "mutex path lost samples\n");
+      return 1;
+    }
+
+    // single consumer topping up batches, as the batch former does
+    MPSCQueue<Sample> queue(4096);
+    std::atomic<bool> mpsc_done{false};
+    uint64_t consumed = 0;
+    std::thread consumer([&] {
+      std::vector<Sample> batch(batch_size);
+      while (true) {
+        size_t n = queue.pop(batch.data(), batch_size);
+        consumed += n;
+        if (n == 0) {
+          if (mpsc_done && queue.empty())
+            break;
+          std::this_thread::yield();
+        }
+      }
+    });
+    double mpsc_ns = run(
+        producers, [&](const Sample *s, int n) { queue.push(s, n); },
+        mpsc_done);
+    consumer.join();
+    if (consumed != total) {
+      fprintf(stderr, "mpsc path lost samples\n");
+      return 1;
+    }
+
+    printf("%10d %16.1f %16.1f %9.2fx\n", producers, mutex_ns / total,
+           mpsc_ns / total, mutex_ns / mpsc_ns);
+  }
+  return 0;
+}
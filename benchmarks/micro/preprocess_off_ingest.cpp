@@ -0,0 +1,134 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Checks that model preprocessing does not hold up ingest. Runs KILT on
+// simulated devices with a model whose preprocessSamples() takes a long
+// time, and fails if any Inference() call takes a sizeable fraction of that
+// time, as it would if preprocessing still ran under an ingest lock.
+//
+//   g++ -O2 -std=c++17 -pthread -DKILT_CONFIG_FROM_ENV -DKILT_CONFIG_TRANSLATE_X -DKILT_DEVICE_SIM -I../.. -I../../devices/sim preprocess_off_ingest.cpp -o preprocess_off_ingest
+//   ./preprocess_off_ingest [preprocess_us] [samples]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "config/kilt_config.h"
+#include "kilt_impl.h"
+#include "devices/sim/device.h"
+
+using namespace KRAI;
+
+struct Sample {
+  uint64_t id;
+  uint64_t index;
+};
+
+static int preprocess_us = 20000;
+
+class SlowModel : public IModel {
+public:
+  void preprocessSamples(IDataSource *data_source, const void *samples,
+                         void *handle,
+                         void (*callback)(void *handle,
+                                          const void *samples)) override {
+    std::this_thread::sleep_for(std::chrono::microseconds(preprocess_us));
+    callback(handle, samples);
+  }
+
+  void configureWorkload(IDataSource *data_source, void *device,
+                         const void *samples,
+                         std::vector<void *> &in_ptrs) override {}
+
+  void postprocessResults(void *samples,
+                          std::vector<void *> &out_ptrs) override {}
+};
+
+class NullDataSource : public IDataSource {
+public:
+  NullDataSource(std::vector<int> &affinities) : IDataSource(affinities) {}
+  void *getSamplePtr(int sample_idx, int buffer_idx) override {
+    return nullptr;
+  }
+  const int getNumAvailableSampleFiles() override { return 0; }
+  const int getNumMaxSamplesInMemory() override { return 0; }
+  void loadSamplesImpl(void *) override {}
+  void unloadSamples(void *user) override {}
+};
+
+namespace KRAI {
+IModelConfig *getModelConfig() { return new IModelConfig(); }
+IDataSourceConfig *getDataSourceConfig() { return new IDataSourceConfig(); }
+IModel *modelConstruct(IConfig *config) { return new SlowModel(); }
+IDataSource *dataSourceConstruct(IConfig *config,
+                                 std::vector<int> affinities) {
+  return new NullDataSource(affinities);
+}
+} // namespace KRAI
+
+int main(int argc, char *argv[]) {
+  if (argc > 1)
+    preprocess_us = atoi(argv[1]);
+  int samples = argc > 2 ? atoi(argv[2]) : 1000;
+
+  // a small simulated setup unless configured otherwise
+  setenv("verbosity", "0", 0);
+  setenv("kilt_device_ids", "0", 0);
+  setenv("kilt_model_batch_size", "16", 0);
+  setenv("kilt_input_format", "UINT8,16,16", 0);
+  setenv("kilt_output_format", "UINT8,16,16", 0);
+  setenv("kilt_max_wait_abs", "1000", 0);
+  setenv("kilt_preprocess_threads", "1", 0);
+  setenv("kilt_device_sim_fixed_us", "100", 0);
+
+  KraiInferenceLibrary<Sample> *kil = new KraiInferenceLibrary<Sample>();
+
+  double worst_us = 0;
+  std::vector<Sample> one(1);
+  for (int i = 0; i < samples; ++i) {
+    one[0] = {(uint64_t)i, (uint64_t)i};
+    auto t0 = std::chrono::steady_clock::now();
+    kil->Inference(one);
+    worst_us = std::max(
+        worst_us, std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count());
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+  kil->Drain();
+  delete kil;
+
+  printf("%d samples, preprocessing %dus per batch, slowest Inference() "
+         "%.1fus\n",
+         samples, preprocess_us, worst_us);
+  if (worst_us > preprocess_us / 2) {
+    fprintf(stderr, "FAILED: Inference() waits for preprocessing\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,143 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+// SPSC handoff microbenchmark: the time from Push() on the dispatcher side
+// to the device scheduler holding the batch, through SPSCRing, for an
+// idle consumer that
+//   - polls the ring without pausing (lowest latency, burns a core),
+//   - spins for a while then blocks in wait() (the default),
+//   - blocks in wait() straight away,
+//   - polls with a fixed sleep between tries, as the scheduler did before.
+// Items are sent with a gap so the consumer is idle when each one arrives.
+// Also reports the raw push/pop throughput with both sides busy.
+//
+//   g++ -O2 -std=c++17 -pthread -I../.. spsc_handoff.cpp -o spsc_handoff
+//   ./spsc_handoff [items] [gap_us] [sleep_us]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+using namespace KRAI;
+
+typedef std::chrono::steady_clock Clock;
+
+enum Mode { POLL, SPIN_WAIT, WAIT, SLEEP };
+
+static void handoff(const char *name, Mode mode, int items, int gap_us,
+                    int sleep_us) {
+  SPSCRing<Clock::time_point> ring(16);
+  std::vector<double> latency(items);
+
+  std::thread consumer([&] {
+    Clock::time_point t;
+    for (int i = 0; i < items;) {
+      if (ring.pop(t)) {
+        latency[i++] =
+            std::chrono::duration<double, std::micro>(Clock::now() - t)
+                .count();
+        continue;
+      }
+      switch (mode) {
+      case POLL:
+        break;
+      case SPIN_WAIT:
+        ring.wait(10000, 20);
+        break;
+      case WAIT:
+        ring.wait(10000, 0);
+        break;
+      case SLEEP:
+        std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+        break;
+      }
+    }
+  });
+
+  for (int i = 0; i < items; ++i) {
+    std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+    while (!ring.push(Clock::now()))
+      ;
+  }
+  consumer.join();
+
+  std::sort(latency.begin(), latency.end());
+  double sum = 0;
+  for (double l : latency)
+    sum += l;
+  printf("%-24s %10.2f %10.2f %10.2f %10.2f\n", name, sum / items,
+         latency[items / 2], latency[items * 99 / 100], latency.back());
+}
+
+static void throughput(int items) {
+  SPSCRing<int> ring(1024);
+  long sum = 0;
+
+  auto t0 = Clock::now();
+  std::thread consumer([&] {
+    int v;
+    for (int i = 0; i < items;) {
+      if (ring.pop(v)) {
+        sum += v;
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (int i = 0; i < items; ++i)
+    while (!ring.push(i))
+      std::this_thread::yield();
+  consumer.join();
+
+  double ns =
+      std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+  if (sum != (long)items * (items - 1) / 2)
+    fprintf(stderr, "FAILED: items lost or corrupted\n");
+  printf("throughput: %.1f ns per item\n", ns / items);
+}
+
+int main(int argc, char *argv[]) {
+  int items = argc > 1 ? atoi(argv[1]) : 5000;
+  int gap_us = argc > 2 ? atoi(argv[2]) : 100;
+  int sleep_us = argc > 3 ? atoi(argv[3]) : 10;
+
+  printf("%d items, %dus apart\n", items, gap_us);
+  printf("%-24s %10s %10s %10s %10s\n", "consumer", "mean us", "p50 us",
+         "p99 us", "max us");
+  handoff("poll", POLL, items, gap_us, sleep_us);
+  handoff("spin 20us then wait", SPIN_WAIT, items, gap_us, sleep_us);
+  handoff("wait", WAIT, items, gap_us, sleep_us);
+  char name[32];
+  snprintf(name, sizeof(name), "sleep %dus between polls", sleep_us);
+  handoff(name, SLEEP, items, gap_us, sleep_us);
+
+  throughput(10000000);
+  return 0;
+}
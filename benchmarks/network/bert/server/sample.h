@@ -50,12 +50,14 @@ struct Sample {
   }
 
   template <typename TInputDataType>
-  void ReadSample(ServerConnection &conn, bool &cancel) {
-    assert(conn.read(&index, sizeof(size_t)));
+  bool ReadSample(ServerConnection &conn) {
+    if (!conn.read(&index, sizeof(size_t)))
+      return false;
 
     uint64_t tmp_buf[384];
 
-    assert(conn.read(tmp_buf, 384 * sizeof(uint64_t), cancel));
+    if (!conn.read(tmp_buf, 384 * sizeof(uint64_t)))
+      return false;
     for (int x = 0; x < 384; ++x)
       reinterpret_cast<TInputDataType *>(buf0)[x] = tmp_buf[x];
 
@@ -70,6 +72,8 @@ struct Sample {
         reinterpret_cast<TInputDataType *>(buf2)[idx] = x;
       } while (reinterpret_cast<TInputDataType *>(buf0)[idx++] != SEPARATOR);
     }
+
+    return true;
   }
 
   void Callback(float *data) {
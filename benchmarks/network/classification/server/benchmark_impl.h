@@ -38,11 +38,6 @@
 
 #include "config/benchmark_config.h"
 
-#if defined(__amd64__) && defined(ENABLE_ZEN2)
-#include <cstdint>
-#include <immintrin.h>
-#endif
-
 namespace KRAI {
 
 template <typename TInputDataType, typename TOutputDataType>
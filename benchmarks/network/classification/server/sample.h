@@ -54,9 +54,8 @@ struct Sample {
   }
 
   template <typename TInputDataType> // TODO: remove this templateness
-  void ReadSample(ServerConnection &conn, bool &cancel) {
-    assert(conn.read(&index, sizeof(size_t)));
-    assert(conn.read(buf, PAYLOAD_SIZE));
+  bool ReadSample(ServerConnection &conn) {
+    return conn.read(&index, sizeof(size_t)) && conn.read(buf, PAYLOAD_SIZE);
   }
 
   void Callback(uint32_t length, float *data) {
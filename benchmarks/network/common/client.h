@@ -59,6 +59,7 @@ public:
               << ":" << ncc.getNetworkServerPort() << std::endl;
 
     payload_size = ncc.getPayloadSize();
+    priority_class = ncc.getPriorityClass();
 
     init_client(ncc.getNetworkServerIPAddress().c_str(),
                 ncc.getNetworkServerPort());
@@ -66,6 +67,13 @@ public:
     for (int s = 0; s < ncc.getNumSockets(); ++s) {
       conns.push_back(std::make_unique<ClientConnection>());
       std::cout << "Connected (" << s << ")" << std::endl;
+
+      // only sent when needed so that older servers keep working
+      if (priority_class != 0) {
+        uintptr_t message = -3;
+        conns.back()->write({{&message, sizeof(uintptr_t)},
+                             {&priority_class, sizeof(uint32_t)}});
+      }
     }
 
     receiver_conn = GetConn();
@@ -244,6 +252,7 @@ private:
   std::string unique_id = "TODO GET THIS FROM THE SERVER";
 
   int payload_size;
+  uint32_t priority_class;
 };
 
 typedef KILTClient KILT;
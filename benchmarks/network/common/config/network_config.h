@@ -40,6 +40,8 @@ public:
 
   const int getPayloadSize() { return payload_size; }
 
+  const int getPriorityClass() { return priority_class; }
+
 private:
   const int num_sockets = getconfig_i("KILT_NETWORK_NUM_SOCKETS");
 
@@ -53,6 +55,10 @@ private:
       alter_str_i(getconfig_c("KILT_NETWORK_SERVER_PORT"), 8080);
 
   const int payload_size = getconfig_i("KILT_NETWORK_PAYLOAD_SIZE");
+
+  // KILT priority class the server batches this client's samples in
+  const int priority_class =
+      alter_str_i(getconfig_c("KILT_NETWORK_PRIORITY_CLASS"), 0);
 };
 
 class NetworkServerConfig {
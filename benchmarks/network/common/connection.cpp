@@ -31,6 +31,7 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <errno.h>
 
 static struct sockaddr_in address;
 static int server_fd; // Only exists for server connections
@@ -59,6 +60,9 @@ void init_server(int port) {
   }
 }
 
+// Unblocks a pending accept so that the server can stop.
+void shutdown_server() { shutdown(server_fd, SHUT_RDWR); }
+
 void init_client(const char *ip_addr, int port) {
   address.sin_family = AF_INET;
   address.sin_port = htons(port);
@@ -70,20 +74,15 @@ void init_client(const char *ip_addr, int port) {
 }
 
 bool Connection::read(void *dest, size_t len) {
-  bool cancel = false;
-  return read(dest, len, cancel);
-}
-
-bool Connection::read(void *dest, size_t len, const bool &cancel) {
   uint8_t *byte_buf = reinterpret_cast<uint8_t *>(dest);
 
   while (len != 0) {
-    if (cancel) {
+    if (read_shutdown.load(std::memory_order_acquire)) {
       return false;
     }
 
-    size_t bytes = ::read(sock, byte_buf, len);
-    if (bytes < 0)
+    ssize_t bytes = ::read(sock, byte_buf, len);
+    if (bytes <= 0)
       return false;
 
     byte_buf += bytes;
@@ -107,8 +106,18 @@ bool Connection::write(std::vector<std::pair<const void *, size_t>> data) {
   return ::send(sock, src, len, 0);
 }
 
+void Connection::shutdownRead() {
+  read_shutdown.store(true, std::memory_order_release);
+  ::shutdown(sock, SHUT_RD);
+}
+
 ServerConnection::ServerConnection() {
   if (listen(server_fd, 8) < 0) {
+    // the listening socket has been shut down
+    if (errno == EINVAL) {
+      sock = -1;
+      return;
+    }
     perror("listen");
     exit(EXIT_FAILURE);
   }
@@ -117,12 +126,19 @@ ServerConnection::ServerConnection() {
 
   if ((sock = ::accept(server_fd, (struct sockaddr *)&address,
                        (socklen_t *)&addrlen)) < 0) {
+    if (errno == EINVAL) {
+      sock = -1;
+      return;
+    }
     perror("accept");
     exit(EXIT_FAILURE);
   }
 }
 
-ServerConnection::~ServerConnection() { close(sock); }
+ServerConnection::~ServerConnection() {
+  if (sock >= 0)
+    close(sock);
+}
 
 ClientConnection::ClientConnection() {
   if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
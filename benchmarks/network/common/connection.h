@@ -25,33 +25,43 @@
 #pragma once
 
 #include <netinet/in.h>
+#include <atomic>
 #include <vector>
 #include <utility>
 
 void init_server(int port);
+void shutdown_server();
 void init_client(const char *ip_addr, int port);
 
 class Connection {
 public:
   virtual ~Connection() = 0;
 
+  // Fails once shutdownRead() has been called, even mid-message.
   bool read(void *dest, size_t len);
-  bool read(void *dest, size_t len, const bool &cancel);
 
   bool write(const void *src, size_t len);
 
   // Optimised version of write that prevents fragmentation
   bool write(std::vector<std::pair<const void *, size_t>> data);
 
+  // Unblock any reader, writes still go through.
+  void shutdownRead();
+
 protected:
   int sock;
   int fd;
+
+  std::atomic<bool> read_shutdown{false};
 };
 
 class ServerConnection : public Connection {
 public:
   ServerConnection();
   ~ServerConnection();
+
+  // set by the client with a SET_PRIORITY_CLASS message
+  uint32_t priority_class = 0;
 };
 
 class ClientConnection : public Connection {
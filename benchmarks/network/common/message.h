@@ -25,6 +25,9 @@
 #ifndef MESSAGE_H
 #define MESSAGE_H
 
-enum MessageHeader { SEND_UID = -1, DISCONNECT = -2 };
+// Any other header is the id of a sample. SET_PRIORITY_CLASS is followed by
+// a uint32_t class for the samples later sent on the same connection, which
+// otherwise default to class 0.
+enum MessageHeader { SEND_UID = -1, DISCONNECT = -2, SET_PRIORITY_CLASS = -3 };
 
 #endif // MESSAGE_H
\ No newline at end of file
@@ -28,6 +28,9 @@
 #include "benchmarks/network/common/connection.h"
 #include "benchmarks/network/common/config/network_config.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
 #include <iostream>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -37,6 +40,15 @@
 
 bool trace = false;
 
+// SIGINT / SIGTERM are forwarded through a pipe so that a normal thread can
+// stop the server.
+static int stop_pipe[2];
+
+static void stop_signal_handler(int) {
+  char c = 0;
+  (void)!::write(stop_pipe[1], &c, 1);
+}
+
 template <typename TInputDataType, typename TSampleType> class Server {
 public:
   Server() {
@@ -47,6 +59,14 @@ public:
 
     init_server(nsc.getNetworkServerPort());
 
+    stopping = false;
+
+    if (pipe(stop_pipe) == 0) {
+      stop_thread = std::thread(&Server::StopThread, this);
+      prev_sigint = signal(SIGINT, stop_signal_handler);
+      prev_sigterm = signal(SIGTERM, stop_signal_handler);
+    }
+
     for (int t = 0; t < nsc.getNumSockets(); ++t) {
       serve_threads.push_back(std::thread(&Server::ServeThread, this));
     }
@@ -55,12 +75,27 @@ public:
   }
 
   ~Server() {
-    // closing the listening socket
-    // shutdown(server_fd, SHUT_RDWR);
+    if (stop_thread.joinable()) {
+      // put the previous handlers back first, so no late signal writes to
+      // the pipe once it is closed
+      signal(SIGINT, prev_sigint);
+      signal(SIGTERM, prev_sigterm);
+
+      // wake the stop thread if no signal ever came
+      stopping = true;
+      char c = 0;
+      (void)!::write(stop_pipe[1], &c, 1);
+      stop_thread.join();
+
+      close(stop_pipe[0]);
+      close(stop_pipe[1]);
+    }
   }
 
+  // Serves until SIGINT / SIGTERM, then stops taking new samples, drains the
+  // ones in flight and returns.
   void Run() {
-    while (true) {
+    while (!stopping) {
 
       switch (state) {
 
@@ -68,27 +103,37 @@ public:
         ReleaseConn(std::move(transmitter_conn));
         CloseConns();
         state = CONNECT;
-        is_disconnecting = false;
       }
 
       case CONNECT: {
-        for (int s = 0; s < nsc.getNumSockets(); ++s) {
+        for (int s = 0; s < nsc.getNumSockets() && !stopping; ++s) {
           std::cout << "Waiting for connection..." << std::endl;
-          conns.push_back(std::make_unique<ServerConnection>());
+          auto conn = std::make_unique<ServerConnection>();
+          mtx_sock.lock();
+          open_conns.push_back(conn.get());
+          conns.push_back(std::move(conn));
+          mtx_sock.unlock();
         };
 
+        if (stopping)
+          break;
+
         transmitter_conn = GetConn();
 
-        state = SERVE;
+        SetState(SERVE);
         std::cout << "Connected." << std::endl;
       }
 
       case SERVE: {
-        //  sleep as covered by threads
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        // serving is covered by the threads, wake up on a disconnect or a
+        // stop request
+        std::unique_lock<std::mutex> lock(mtx_state);
+        cv_state.wait(lock, [this] { return stopping || state != SERVE; });
       };
       }
     }
+
+    Shutdown();
   }
 
   void ServeThread() {
@@ -110,14 +155,16 @@ public:
     static char uid_string[128];
     strcpy(uid_string, kil.UniqueServerID().c_str());
 
-    while (true) {
+    while (!stopping) {
       std::this_thread::yield();
 
       if (state == SERVE) {
         auto conn = GetConn();
+        if (conn == nullptr)
+          break;
 
         uintptr_t message_header;
-        if (conn->read(&message_header, sizeof(uintptr_t), is_disconnecting)) {
+        if (conn->read(&message_header, sizeof(uintptr_t))) {
           if (message_header == -1) {
             std::cout << "Sending UID..." << std::endl;
             // reply with name
@@ -126,8 +173,13 @@ public:
           } else if (message_header == -2) {
             // disconnect
             std::cout << std::endl << "Disconnecting." << std::endl;
-            state = DISCONNECT;
-            is_disconnecting = true;
+            ShutdownReads();
+            SetState(DISCONNECT);
+          } else if (message_header == -3) {
+            // priority class of the samples that follow on this connection
+            uint32_t priority_class;
+            if (conn->read(&priority_class, sizeof(uint32_t)))
+              conn->priority_class = priority_class;
           } else { // must be a sample
 
             sample->AllocateBuffers();
@@ -136,12 +188,15 @@ public:
             sample->reply_conn = transmitter_conn.get();
             sample->send_mtx = &mtx_tx;
 
-            sample->ReadSample<TInputDataType>(*conn, is_disconnecting);
-
-            if (trace)
-              std::cout << ">";
+            // a sample cut off by a disconnect or a stop is dropped
+            if (sample->ReadSample<TInputDataType>(*conn)) {
+              if (trace)
+                std::cout << ">";
 
-            kil.Inference(samples);
+              kil.Inference(samples, conn->priority_class);
+            } else {
+              sample->FreeBuffers();
+            }
           }
         }
         ReleaseConn(std::move(conn));
@@ -152,10 +207,59 @@ public:
 private:
   enum State { DISCONNECT, CONNECT, SERVE };
 
+  void SetState(State s) {
+    mtx_state.lock();
+    state = s;
+    mtx_state.unlock();
+    cv_state.notify_all();
+  }
+
+  void StopThread() {
+    char c;
+    while (::read(stop_pipe[0], &c, 1) < 0 && errno == EINTR)
+      ;
+
+    if (!stopping)
+      std::cout << std::endl << "Stop requested." << std::endl;
+
+    mtx_state.lock();
+    stopping = true;
+    mtx_state.unlock();
+    cv_state.notify_all();
+
+    // unblock Run() if it is waiting for clients
+    shutdown_server();
+  }
+
+  void Shutdown() {
+    // stop admission - unblock the serve threads' reads, replies can
+    // still be written
+    ShutdownReads();
+
+    for (auto &t : serve_threads)
+      t.join();
+
+    kil.Drain();
+
+    if (transmitter_conn != nullptr)
+      ReleaseConn(std::move(transmitter_conn));
+    mtx_sock.lock();
+    conns.clear();
+    open_conns.clear();
+    mtx_sock.unlock();
+  }
+
+  void ShutdownReads() {
+    mtx_sock.lock();
+    for (auto conn : open_conns)
+      conn->shutdownRead();
+    mtx_sock.unlock();
+  }
+
   std::unique_ptr<ServerConnection> GetConn() {
     std::unique_ptr<ServerConnection> conn = nullptr;
 
-    while (conn == nullptr) {
+    while (conn == nullptr && !stopping) {
       mtx_sock.lock();
       if (conns.size() != 0) {
         conn = std::move(conns.back());
@@ -180,6 +284,7 @@ private:
       // if all the sockets have now unused
       if (conns.size() == nsc.getNumSockets()) {
         conns.clear();
+        open_conns.clear();
         complete = true;
       }
       mtx_sock.unlock();
@@ -192,13 +297,22 @@ private:
 
   std::unique_ptr<ServerConnection> transmitter_conn;
 
+  // every connection currently open, including those held by serve threads
+  std::vector<ServerConnection *> open_conns;
+
   std::mutex mtx_sock;
   std::mutex mtx_tx;
 
   NetworkServerConfig nsc;
 
-  State state;
+  // written under mtx_state, read without it by the serve threads
+  std::atomic<State> state;
+  std::mutex mtx_state;
+  std::condition_variable cv_state;
   std::vector<std::thread> serve_threads;
 
-  bool is_disconnecting = false;
+  std::atomic<bool> stopping;
+  std::thread stop_thread;
+  void (*prev_sigint)(int) = SIG_DFL;
+  void (*prev_sigterm)(int) = SIG_DFL;
 };
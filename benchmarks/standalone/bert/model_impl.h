@@ -92,7 +92,9 @@ public:
         static_cast<SquadDataSourceConfig *>(_config->datasource_cfg)
             ->getDataSourceSequenceLength();
 
-    _zero_buffer = std::vector<TInputDataType>(packed_seq_len, 0);
+    _position_buffer = std::vector<TInputDataType>(packed_seq_len);
+    for (int i = 0; i < packed_seq_len; ++i)
+      _position_buffer[i] = i;
   }
 
   // -------------- IModel interface BEGIN --------------------- //
@@ -199,28 +201,23 @@ private:
       d->SyncData(src2, in_ptrs[2], offset * sizeof(TInputDataType),
                   sample_seq_len * sizeof(TInputDataType));
 
-      for (TInputDataType m = 0; m < sample_seq_len; m++) {
-        d->SyncData(&m, in_ptrs[3], offset * sizeof(TInputDataType),
-                    sizeof(TInputDataType));
-        ++offset;
-      }
+      d->SyncData(_position_buffer.data(), in_ptrs[3],
+                  offset * sizeof(TInputDataType),
+                  sample_seq_len * sizeof(TInputDataType));
+      offset += sample_seq_len;
 
       d->SyncData(&sample_seq_len, in_ptrs[1], s * sizeof(TInputDataType),
                   sizeof(TInputDataType));
     }
 
     // Zero the remainder of the buffers
-    d->SyncData(_zero_buffer.data(), in_ptrs[0],
-                offset * sizeof(TInputDataType),
+    d->ZeroData(in_ptrs[0], offset * sizeof(TInputDataType),
                 (packed_seq_len - offset) * sizeof(TInputDataType));
-    d->SyncData(_zero_buffer.data(), in_ptrs[2],
-                offset * sizeof(TInputDataType),
+    d->ZeroData(in_ptrs[2], offset * sizeof(TInputDataType),
                 (packed_seq_len - offset) * sizeof(TInputDataType));
-    d->SyncData(_zero_buffer.data(), in_ptrs[3],
-                offset * sizeof(TInputDataType),
+    d->ZeroData(in_ptrs[3], offset * sizeof(TInputDataType),
                 (packed_seq_len - offset) * sizeof(TInputDataType));
-    d->SyncData(_zero_buffer.data(), in_ptrs[1],
-                sm->size() * sizeof(TInputDataType),
+    d->ZeroData(in_ptrs[1], sm->size() * sizeof(TInputDataType),
                 (8 - sm->size()) * sizeof(TInputDataType));
   }
 
@@ -318,8 +315,8 @@ private:
   unsigned int datasource_seq_len;
   unsigned int packed_seq_len;
 
-  // zero buffer to blank data
-  std::vector<TInputDataType> _zero_buffer;
+  // 0, 1, 2, ... - the position ids of a packed sequence
+  std::vector<TInputDataType> _position_buffer;
 
   // handle to config
   const IConfig *_config;
@@ -39,11 +39,6 @@ typedef mlperf::QuerySample Sample; // Type is superseded by sample.h in network
 #include "datasource_impl.h"
 #include "loadgen.h"
 
-#if defined(__amd64__) && defined(ENABLE_ZEN2)
-#include <cstdint>
-#include <immintrin.h>
-#endif
-
 #define DEBUG(msg) std::cout << "DEBUG: " << msg << std::endl;
 
 namespace KRAI {
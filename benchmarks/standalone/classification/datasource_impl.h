@@ -33,7 +33,8 @@ namespace KRAI {
 
 template <typename TData> class StaticBuffer {
 public:
-  StaticBuffer(const int size, TData *buffer = nullptr) : _size(size) {
+  StaticBuffer(const int size, TData *buffer = nullptr)
+      : _size(size), _owned(buffer == nullptr) {
     if (buffer != nullptr)
       _buffer = buffer;
     else
@@ -45,13 +46,18 @@ public:
 #endif
   }
 
-  virtual ~StaticBuffer() { free(_buffer); }
+  virtual ~StaticBuffer() {
+    if (_owned)
+      free(_buffer);
+  }
 
   TData *data() const { return _buffer; }
   int size() const { return _size; }
 
 protected:
   const int _size;
+  // false when the buffer is a slice of someone else's allocation
+  const bool _owned;
   TData *_buffer;
 };
 
@@ -127,31 +133,31 @@ public:
     unsigned length = _filenames_buffer.size();
     _current_buffer_size = length;
     _in_batch = new std::unique_ptr<SampleData<TInputDataType>>[length];
-    unsigned batch_size = _config->model_cfg->getBatchSize();
     unsigned image_size = datasource_cfg->getImageSize() *
                           datasource_cfg->getImageSize() *
                           datasource_cfg->getNumChannels();
 
-    // TODO: Remove the batching code as no longer required.
-    for (auto i = 0; i < length; i += batch_size) {
-      unsigned actual_batch_size =
-          std::min(batch_size, batch_size < length ? (length - i) : length);
-
-      for (auto j = 0; j < actual_batch_size; j++) {
-        _in_batch[i + j].reset(new SampleData<TInputDataType>(image_size));
-        std::string path =
-            datasource_cfg->getDatasetDir() + "/" + _filenames_buffer[i + j];
-        _in_batch[i + j]->load(path, vl);
-      }
+    // All samples go back to back in one page aligned arena, in load order,
+    // so a batch of consecutively loaded samples is already contiguous and
+    // the device can bind to it without a copy.
+    size_t arena_size = (size_t)length * image_size * sizeof(TInputDataType);
+    _arena = (TInputDataType *)aligned_alloc(4096,
+                                             (arena_size + 4095) / 4096 * 4096);
+
+    for (auto i = 0; i < length; i++) {
+      _in_batch[i].reset(new SampleData<TInputDataType>(
+          image_size, _arena + (size_t)i * image_size));
+      std::string path =
+          datasource_cfg->getDatasetDir() + "/" + _filenames_buffer[i];
+      _in_batch[i]->load(path, vl);
     }
   }
 
   void unloadSamples(void *user) override {
-    unsigned num_examples = _filenames_buffer.size();
-    uint16_t batch_size = _config->model_cfg->getBatchSize();
-    for (size_t i = 0; i < num_examples; i += batch_size) {
-      delete _in_batch[i].get();
-    }
+    delete[] _in_batch;
+    _in_batch = nullptr;
+    free(_arena);
+    _arena = nullptr;
   }
 
   virtual void *getSamplePtr(int img_idx, int) {
@@ -171,7 +177,8 @@ public:
 private:
   const IConfig *_config;
   std::vector<std::string> _filenames_buffer;
-  std::unique_ptr<SampleData<TInputDataType>> *_in_batch;
+  std::unique_ptr<SampleData<TInputDataType>> *_in_batch = nullptr;
+  TInputDataType *_arena = nullptr;
   ClassificationDataSourceConfig *datasource_cfg;
   int _current_buffer_size = 0;
 };
@@ -33,11 +33,6 @@
 
 #include "config/benchmark_config.h"
 
-#if defined(__amd64__) && defined(ENABLE_ZEN2)
-#include <cstdint>
-#include <immintrin.h>
-#endif
-
 namespace KRAI {
 
 template <typename TInputDataType, typename TOutputDataType>
@@ -71,6 +66,26 @@ public:
     }
   }
 
+  void *getContiguousInput(IDataSource *data_source, const void *samples,
+                           int buf_idx) {
+
+    const std::vector<Sample> *s =
+        reinterpret_cast<const std::vector<Sample> *>(samples);
+
+    if (buf_idx != 0 || s->size() != _config->model_cfg->getBatchSize())
+      return nullptr;
+
+    uint8_t *base =
+        reinterpret_cast<uint8_t *>(getSamplePtr(data_source, &(*s)[0], 0));
+
+    for (int i = 1; i < s->size(); ++i)
+      if (getSamplePtr(data_source, &(*s)[i], 0) !=
+          base + i * input_buffer_size)
+        return nullptr;
+
+    return base;
+  }
+
   void postprocessResults(void *samples, std::vector<void *> &out_ptrs) {
 
     int probe_offset = datasource_cfg->getHasBackgroundClass() ? 1 : 0;
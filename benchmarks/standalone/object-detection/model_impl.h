@@ -139,6 +139,26 @@ public:
     (this->*ppr_ptr)(samples, out_ptrs);
   }
 
+  virtual void *getContiguousInput(IDataSource *data_source, const void *samples,
+                           int buf_idx) {
+
+    const std::vector<Sample> *s =
+        reinterpret_cast<const std::vector<Sample> *>(samples);
+
+    if (buf_idx != 0 || s->size() != _config->model_cfg->getBatchSize())
+      return nullptr;
+
+    uint8_t *base =
+        reinterpret_cast<uint8_t *>(getSamplePtr(data_source, &(*s)[0], 0));
+
+    for (int i = 1; i < s->size(); ++i)
+      if (getSamplePtr(data_source, &(*s)[i], 0) !=
+          base + i * input_buf_size)
+        return nullptr;
+
+    return base;
+  }
+
   // -------------- IModel interface END ----------------------- //
 
 private:
@@ -39,6 +39,20 @@ class ServerConfig : public IServerConfig {
 public:
   // Server settings
   virtual const int getMaxWait() const { return max_wait; }
+  virtual const int getLatencyTarget() const { return latency_target; }
+
+  virtual const int getPriorityClassCount() const {
+    return class_max_wait.size();
+  }
+  virtual const int getPriorityClassMaxWait(int c) const {
+    return class_max_wait[c];
+  }
+  virtual const int getPriorityClassBatchCap(int c) const {
+    return class_batch_cap[c];
+  }
+  virtual const int getPriorityClassDeadline(int c) const {
+    return class_deadline[c];
+  }
   virtual const int getVerbosity() const { return verbosity_level; }
   virtual const int getVerbosityServer() const { return verbosity_server; }
   virtual const int getBatchSize() const { return qaic_batch_size; }
@@ -63,8 +77,88 @@ public:
 
   virtual const int getDispatchYieldTime() { return dispatch_yield_time; }
 
+  virtual const DISPATCH_POLICY getDispatchPolicy() { return dispatch_policy; }
+
+  virtual const int getIngestQueueLength() { return ingest_queue_length; }
+
+  virtual const int getDrainTimeout() { return drain_timeout; }
+
+  virtual const int getPreprocessThreadCount() {
+    return preprocess_thread_count;
+  }
+  virtual const std::vector<int> getPreprocessAffinity() {
+    return preprocess_affinity;
+  }
+
   ServerConfig() {
 
+    // Class 0 takes the server wide settings. Further classes come from
+    // a comma separated list of max_wait:batch_cap[:deadline] (us).
+    class_max_wait.push_back(max_wait);
+    class_batch_cap.push_back(qaic_batch_size);
+    class_deadline.push_back(latency_target > 0 ? latency_target : max_wait);
+
+    if (priority_classes_str != "") {
+      std::stringstream ss_classes(priority_classes_str);
+      while (ss_classes.good()) {
+        std::string substr;
+        std::getline(ss_classes, substr, ',');
+
+        const std::string where = "KILT_PRIORITY_CLASSES class " +
+                                  std::to_string(class_max_wait.size()) +
+                                  " (\"" + substr + "\")";
+
+        std::stringstream ss_fields(substr);
+        std::vector<int> fields;
+        while (ss_fields.good()) {
+          std::string field;
+          std::getline(ss_fields, field, ':');
+          const char *names[] = {"max_wait", "batch_cap", "deadline"};
+          if (fields.size() == 3)
+            throw std::invalid_argument(
+                where + ": expects max_wait:batch_cap[:deadline]");
+          size_t end = 0;
+          int value = -1;
+          try {
+            value = std::stoi(field, &end);
+          } catch (const std::exception &) {
+          }
+          if (end != field.size() || value < 0)
+            throw std::invalid_argument(where + ": " + names[fields.size()] +
+                                        " \"" + field +
+                                        "\" is not a non-negative integer");
+          fields.push_back(value);
+        }
+        if (fields.size() < 2)
+          throw std::invalid_argument(
+              where + ": expects max_wait:batch_cap[:deadline]");
+
+        class_max_wait.push_back(fields[0]);
+        class_batch_cap.push_back(fields[1]);
+        class_deadline.push_back(fields.size() > 2 ? fields[2] : fields[0]);
+      }
+    }
+
+    std::string dispatch_policy_string = alter_str(
+        getconfig_c("KILT_DISPATCH_POLICY"), std::string("ROUND_ROBIN"));
+
+    if (dispatch_policy_string == "LEAST_OUTSTANDING")
+      dispatch_policy = LEAST_OUTSTANDING;
+    else if (dispatch_policy_string == "POWER_OF_TWO")
+      dispatch_policy = POWER_OF_TWO;
+    else
+      dispatch_policy = ROUND_ROBIN; // default to round robin
+
+    // comma separated list of cores for the preprocessing workers
+    if (preprocess_affinity_str != "") {
+      std::stringstream ss_aff(preprocess_affinity_str);
+      while (ss_aff.good()) {
+        std::string substr;
+        std::getline(ss_aff, substr, ',');
+        preprocess_affinity.push_back(std::stoi(substr));
+      }
+    }
+
     std::stringstream ss_ids(qaic_hw_ids_str);
     while (ss_ids.good()) {
       std::string substr;
@@ -174,12 +268,32 @@ private:
 
   const int max_wait = alter_str_i(getconfig_c("KILT_MAX_WAIT_ABS"), 100000);
 
+  // per sample latency target (us) for adaptive batching, 0 disables it
+  const int latency_target =
+      alter_str_i(getconfig_c("KILT_LATENCY_TARGET"), 0);
+
+  std::string priority_classes_str =
+      alter_str(getconfig_c("KILT_PRIORITY_CLASSES"), std::string(""));
+
   const int scheduler_yield_time =
       alter_str_i(getconfig_c("KILT_SCHEDULER_YIELD_TIME"), 10);
 
   const int dispatch_yield_time =
       alter_str_i(getconfig_c("KILT_DISPATCH_YIELD_TIME"), -1);
 
+  const int ingest_queue_length =
+      alter_str_i(getconfig_c("KILT_INGEST_QUEUE_LENGTH"), 65536);
+
+  // how long (ms) shutdown waits for samples in flight
+  const int drain_timeout =
+      alter_str_i(getconfig_c("KILT_DRAIN_TIMEOUT"), 10000);
+
+  const int preprocess_thread_count =
+      alter_str_i(getconfig_c("KILT_PREPROCESS_THREADS"), 1);
+
+  std::string preprocess_affinity_str =
+      alter_str(getconfig_c("KILT_PREPROCESS_AFFINITY"), std::string(""));
+
   //   // choice of hardware
   std::string qaic_hw_ids_str =
       alter_str(getconfig_c("KILT_DEVICE_IDS"), std::string("0"));
@@ -201,6 +315,11 @@ private:
   std::vector<std::vector<int>> qaic_hw_affinities;
   std::vector<std::vector<int>> qaic_datasource_affinities;
   std::vector<int> qaic_hw_datasource_for_device;
+  std::vector<int> preprocess_affinity;
+  DISPATCH_POLICY dispatch_policy;
+  std::vector<int> class_max_wait;
+  std::vector<int> class_batch_cap;
+  std::vector<int> class_deadline;
 };
 
 IServerConfig *getServerConfig() { return new ServerConfig(); }
@@ -87,26 +87,77 @@ Translation translation_table[] = {
     {"KILT_DEVICE_QAIC_THREADS_PER_QUEUE", "CK_ENV_QAIC_THREADS_PER_QUEUE"},
     {"KILT_DEVICE_QAIC_ACTIVATION_COUNT", "CK_ENV_QAIC_ACTIVATION_COUNT"},
     {"KILT_DEVICE_QAIC_INPUT_SELECT", "CK_ENV_QAIC_INPUT_SELECT"},
+    {"KILT_DEVICE_QAIC_INPUT_ALIGNMENT", "KILT_DEVICE_QAIC_INPUT_ALIGNMENT"},
+    {"KILT_DEVICE_QAIC_DYNAMIC_BATCH", "KILT_DEVICE_QAIC_DYNAMIC_BATCH"},
+    {"KILT_DEVICE_QAIC_PROGRAM_MMAP", "KILT_DEVICE_QAIC_PROGRAM_MMAP"},
+    {"KILT_DEVICE_QAIC_PROGRAM_POPULATE", "KILT_DEVICE_QAIC_PROGRAM_POPULATE"},
+    {"KILT_DEVICE_QAIC_BUFFER_ARENA", "KILT_DEVICE_QAIC_BUFFER_ARENA"},
+    {"KILT_DEVICE_QAIC_BUFFER_HUGEPAGES", "KILT_DEVICE_QAIC_BUFFER_HUGEPAGES"},
+    {"KILT_DEVICE_QAIC_BUFFER_ALIGNMENT", "KILT_DEVICE_QAIC_BUFFER_ALIGNMENT"},
     {"KILT_DEVICE_QAIC_SAMPLES_QUEUE_DEPTH",
      "KILT_DEVICE_QAIC_SAMPLES_QUEUE_DEPTH"},
     {"KILT_DEVICE_QAIC_RINGFENCE_DRIVER", "KILT_DEVICE_QAIC_RINGFENCE_DRIVER"},
     {"KILT_DEVICE_QAIC_SCHEDULER_YIELD_TIME",
      "KILT_DEVICE_SCHEDULER_YIELD_TIME"},
+    {"KILT_DEVICE_QAIC_SCHEDULER_SPIN_TIME",
+     "KILT_DEVICE_QAIC_SCHEDULER_SPIN_TIME"},
+    {"KILT_DEVICE_QAIC_ENQUEUE_THREADS", "KILT_DEVICE_QAIC_ENQUEUE_THREADS"},
     {"KILT_DEVICE_QAIC_ENQUEUE_YIELD_TIME", "KILT_DEVICE_ENQUEUE_YIELD_TIME"},
 
+    // device cpu
+    {"KILT_DEVICE_CPU_QUEUE_LENGTH", "KILT_DEVICE_CPU_QUEUE_LENGTH"},
+    {"KILT_DEVICE_CPU_ACTIVATION_COUNT", "KILT_DEVICE_CPU_ACTIVATION_COUNT"},
+    {"KILT_DEVICE_CPU_WORKER_THREADS", "KILT_DEVICE_CPU_WORKER_THREADS"},
+    {"KILT_DEVICE_CPU_SAMPLES_QUEUE_DEPTH",
+     "KILT_DEVICE_CPU_SAMPLES_QUEUE_DEPTH"},
+    {"KILT_DEVICE_CPU_SCHEDULER_YIELD_TIME",
+     "KILT_DEVICE_CPU_SCHEDULER_YIELD_TIME"},
+    {"KILT_DEVICE_CPU_SCHEDULER_SPIN_TIME",
+     "KILT_DEVICE_CPU_SCHEDULER_SPIN_TIME"},
+    {"KILT_DEVICE_CPU_COMPUTE", "KILT_DEVICE_CPU_COMPUTE"},
+
+    // device sim
+    {"KILT_DEVICE_SIM_SLOTS", "KILT_DEVICE_SIM_SLOTS"},
+    {"KILT_DEVICE_SIM_SAMPLES_QUEUE_DEPTH",
+     "KILT_DEVICE_SIM_SAMPLES_QUEUE_DEPTH"},
+    {"KILT_DEVICE_SIM_SCHEDULER_YIELD_TIME",
+     "KILT_DEVICE_SIM_SCHEDULER_YIELD_TIME"},
+    {"KILT_DEVICE_SIM_SCHEDULER_SPIN_TIME",
+     "KILT_DEVICE_SIM_SCHEDULER_SPIN_TIME"},
+    {"KILT_DEVICE_SIM_FIXED_US", "KILT_DEVICE_SIM_FIXED_US"},
+    {"KILT_DEVICE_SIM_PER_SAMPLE_US", "KILT_DEVICE_SIM_PER_SAMPLE_US"},
+    {"KILT_DEVICE_SIM_JITTER", "KILT_DEVICE_SIM_JITTER"},
+    {"KILT_DEVICE_SIM_JITTER_US", "KILT_DEVICE_SIM_JITTER_US"},
+    {"KILT_DEVICE_SIM_STRAGGLER_RATE", "KILT_DEVICE_SIM_STRAGGLER_RATE"},
+    {"KILT_DEVICE_SIM_STRAGGLER_FACTOR", "KILT_DEVICE_SIM_STRAGGLER_FACTOR"},
+    {"KILT_DEVICE_SIM_SEED", "KILT_DEVICE_SIM_SEED"},
+    {"KILT_DEVICE_SIM_SPIN_US", "KILT_DEVICE_SIM_SPIN_US"},
+    {"KILT_DEVICE_SIM_POSTPROCESS_THREADS",
+     "KILT_DEVICE_SIM_POSTPROCESS_THREADS"},
+
     // network
     {"KILT_NETWORK_SERVER_PORT", "NETWORK_SERVER_PORT"},
     {"KILT_NETWORK_SERVER_IP_ADDRESS", "NETWORK_SERVER_IP_ADDRESS"},
     {"KILT_NETWORK_NUM_SOCKETS", "NETWORK_NUM_SOCKETS"},
     {"KILT_NETWORK_PAYLOAD_SIZE", "KILT_NETWORK_PAYLOAD_SIZE"},
+    {"KILT_NETWORK_PRIORITY_CLASS", "KILT_NETWORK_PRIORITY_CLASS"},
 
     // kilt base
     {"KILT_VERBOSE", "CK_VERBOSE"},
     {"KILT_VERBOSE_SERVER", "CK_VERBOSE_SERVER"},
     {"KILT_JSON_CONFIG", "KILT_JSON_CONFIG"},
     {"KILT_MAX_WAIT_ABS", "CK_ENV_QAIC_MAX_WAIT_ABS"},
+    {"KILT_LATENCY_TARGET", "KILT_LATENCY_TARGET"},
+    {"KILT_PRIORITY_CLASSES", "KILT_PRIORITY_CLASSES"},
     {"KILT_SCHEDULER_YIELD_TIME", "KILT_SCHEDULER_YIELD_TIME"},
     {"KILT_DISPATCH_YIELD_TIME", "KILT_DISPATCH_YIELD_TIME"},
+    {"KILT_INGEST_QUEUE_LENGTH", "KILT_INGEST_QUEUE_LENGTH"},
+    {"KILT_DRAIN_TIMEOUT", "KILT_DRAIN_TIMEOUT"},
+    {"KILT_PREPROCESS_THREADS", "KILT_PREPROCESS_THREADS"},
+    {"KILT_PREPROCESS_AFFINITY", "KILT_PREPROCESS_AFFINITY"},
+    {"KILT_DISPATCH_POLICY", "KILT_DISPATCH_POLICY"},
+    {"KILT_COPY_ISA", "KILT_COPY_ISA"},
+    {"KILT_COPY_NT_THRESHOLD", "KILT_COPY_NT_THRESHOLD"},
     {"KILT_DEVICE_IDS", "CK_ENV_QAIC_DEVICE_IDS"},
     {"KILT_DEVICE_CONFIG", "CK_ENV_QAIC_DEVICE_CONFIG"},
     {"KILT_DATASOURCE_CONFIG", "CK_ENV_QAIC_DATASOURCE_CONFIG"},
@@ -112,13 +112,54 @@ Translation translation_table[] = {
     {"KILT_DEVICE_QAIC_THREADS_PER_QUEUE", "qaic_threads_per_queue"},
     {"KILT_DEVICE_QAIC_ACTIVATION_COUNT", "qaic_activation_count"},
     {"KILT_DEVICE_QAIC_INPUT_SELECT", "qaic_input_select"},
+    {"KILT_DEVICE_QAIC_INPUT_ALIGNMENT", "qaic_input_alignment"},
+    {"KILT_DEVICE_QAIC_DYNAMIC_BATCH", "qaic_dynamic_batch"},
+    {"KILT_DEVICE_QAIC_PROGRAM_MMAP", "qaic_program_mmap"},
+    {"KILT_DEVICE_QAIC_PROGRAM_POPULATE", "qaic_program_populate"},
+    {"KILT_DEVICE_QAIC_BUFFER_ARENA", "qaic_buffer_arena"},
+    {"KILT_DEVICE_QAIC_BUFFER_HUGEPAGES", "qaic_buffer_hugepages"},
+    {"KILT_DEVICE_QAIC_BUFFER_ALIGNMENT", "qaic_buffer_alignment"},
     {"KILT_DEVICE_QAIC_SAMPLES_QUEUE_DEPTH", "kilt_device_samples_queue_depth"},
     {"KILT_DEVICE_QAIC_RINGFENCE_DRIVER", "kilt_device_ringfence_driver"},
     {"KILT_DEVICE_QAIC_SCHEDULER_YIELD_TIME",
      "kilt_device_scheduler_yield_time"},
+    {"KILT_DEVICE_QAIC_SCHEDULER_SPIN_TIME",
+     "kilt_device_scheduler_spin_time"},
+    {"KILT_DEVICE_QAIC_ENQUEUE_THREADS", "kilt_device_enqueue_threads"},
     {"KILT_DEVICE_QAIC_ENQUEUE_YIELD_TIME", "kilt_device_enqueue_yield_time"},
     {"KILT_DEVICE_QAIC_EXECUTION_MODE", "kilt_device_execution_mode"},
 
+    // device cpu
+    {"KILT_DEVICE_CPU_QUEUE_LENGTH", "cpu_queue_length"},
+    {"KILT_DEVICE_CPU_ACTIVATION_COUNT", "cpu_activation_count"},
+    {"KILT_DEVICE_CPU_WORKER_THREADS", "cpu_worker_threads"},
+    {"KILT_DEVICE_CPU_SAMPLES_QUEUE_DEPTH",
+     "kilt_device_cpu_samples_queue_depth"},
+    {"KILT_DEVICE_CPU_SCHEDULER_YIELD_TIME",
+     "kilt_device_cpu_scheduler_yield_time"},
+    {"KILT_DEVICE_CPU_SCHEDULER_SPIN_TIME",
+     "kilt_device_cpu_scheduler_spin_time"},
+    {"KILT_DEVICE_CPU_COMPUTE", "kilt_device_cpu_compute"},
+
+    // device sim
+    {"KILT_DEVICE_SIM_SLOTS", "kilt_device_sim_slots"},
+    {"KILT_DEVICE_SIM_SAMPLES_QUEUE_DEPTH",
+     "kilt_device_sim_samples_queue_depth"},
+    {"KILT_DEVICE_SIM_SCHEDULER_YIELD_TIME",
+     "kilt_device_sim_scheduler_yield_time"},
+    {"KILT_DEVICE_SIM_SCHEDULER_SPIN_TIME",
+     "kilt_device_sim_scheduler_spin_time"},
+    {"KILT_DEVICE_SIM_FIXED_US", "kilt_device_sim_fixed_us"},
+    {"KILT_DEVICE_SIM_PER_SAMPLE_US", "kilt_device_sim_per_sample_us"},
+    {"KILT_DEVICE_SIM_JITTER", "kilt_device_sim_jitter"},
+    {"KILT_DEVICE_SIM_JITTER_US", "kilt_device_sim_jitter_us"},
+    {"KILT_DEVICE_SIM_STRAGGLER_RATE", "kilt_device_sim_straggler_rate"},
+    {"KILT_DEVICE_SIM_STRAGGLER_FACTOR", "kilt_device_sim_straggler_factor"},
+    {"KILT_DEVICE_SIM_SEED", "kilt_device_sim_seed"},
+    {"KILT_DEVICE_SIM_SPIN_US", "kilt_device_sim_spin_us"},
+    {"KILT_DEVICE_SIM_POSTPROCESS_THREADS",
+     "kilt_device_sim_postprocess_threads"},
+
     // device TensorRT
     {"KILT_DEVICE_TENSORRT_NUMBER_OF_STREAMS", "tensorrt_number_of_stream"},
     {"KILT_DEVICE_TENSORRT_BATCH_SIZE", "tensorrt_batch_size"},
@@ -147,14 +188,24 @@ Translation translation_table[] = {
     {"KILT_NETWORK_SERVER_IP_ADDRESS", "network_server_ip_address"},
     {"KILT_NETWORK_NUM_SOCKETS", "network_num_sockets"},
     {"KILT_NETWORK_PAYLOAD_SIZE", "network_payload_size"},
+    {"KILT_NETWORK_PRIORITY_CLASS", "network_priority_class"},
 
     // kilt base
     {"KILT_VERBOSE", "verbosity"},
     {"KILT_VERBOSE_SERVER", "CK_VERBOSE_SERVER"},
     {"KILT_JSON_CONFIG", "KILT_JSON_CONFIG"},
     {"KILT_MAX_WAIT_ABS", "kilt_max_wait_abs"},
+    {"KILT_LATENCY_TARGET", "kilt_latency_target"},
+    {"KILT_PRIORITY_CLASSES", "kilt_priority_classes"},
     {"KILT_SCHEDULER_YIELD_TIME", "kilt_scheduler_yield_time"},
     {"KILT_DISPATCH_YIELD_TIME", "kilt_dispatch_yield_time"},
+    {"KILT_INGEST_QUEUE_LENGTH", "kilt_ingest_queue_length"},
+    {"KILT_DRAIN_TIMEOUT", "kilt_drain_timeout"},
+    {"KILT_PREPROCESS_THREADS", "kilt_preprocess_threads"},
+    {"KILT_PREPROCESS_AFFINITY", "kilt_preprocess_affinity"},
+    {"KILT_DISPATCH_POLICY", "kilt_dispatch_policy"},
+    {"KILT_COPY_ISA", "kilt_copy_isa"},
+    {"KILT_COPY_NT_THRESHOLD", "kilt_copy_nt_threshold"},
     {"KILT_DEVICE_IDS", "kilt_device_ids"},
     {"KILT_DEVICE_CONFIG", "kilt_device_config"},
     {"KILT_DATASOURCE_CONFIG", "kilt_datasource_config"},
@@ -0,0 +1,325 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef COPY_KERNELS_H
+#define COPY_KERNELS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "config/config_tools/config_tools.h"
+
+namespace KRAI {
+
+// Host copy and zero-fill kernels used to stage inputs into device buffers.
+//
+// Copies at or above the non-temporal threshold use streaming stores, so
+// large staging buffers - which the CPU never reads back - do not evict the
+// working set from the cache. The instruction set for those is picked once at
+// run time rather than at build time, so one binary runs well across CPU
+// families. Each vector kernel copies an unaligned head with memcpy up to the
+// destination's vector alignment, streams the body (the source may stay
+// unaligned) and finishes the tail with memcpy. Below the threshold the
+// kernels defer to memcpy/memset, which libc already dispatches per ISA
+// (NEON on Arm) and which beat hand-written temporal loops.
+//
+// KILT_COPY_ISA (GENERIC, AVX2, AVX512) forces a kernel and
+// KILT_COPY_NT_THRESHOLD sets the streaming threshold in bytes. By default
+// the threshold is 3/4 of one thread's share of the last level cache, the
+// point from which glibc's own memcpy streams too: a single copy that size
+// would push out most of what the thread keeps cached. It is kept within
+// 256KB - 4MB, as hypervisors can report odd cache topologies. Per-sample
+// copies of small inputs (e.g. BERT, 224x224 images) stay below it and go to
+// memcpy; lower the threshold to stream those as well.
+
+enum class CopyIsa { GENERIC, AVX2, AVX512 };
+
+typedef void (*CopyKernel)(void *dest, const void *src, size_t size, bool nt);
+typedef void (*ZeroKernel)(void *dest, size_t size, bool nt);
+
+inline void copyGeneric(void *dest, const void *src, size_t size, bool nt) {
+  memcpy(dest, src, size);
+}
+
+inline void zeroGeneric(void *dest, size_t size, bool nt) {
+  memset(dest, 0, size);
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2"))) inline void
+copyAvx2(void *dest, const void *src, size_t size, bool nt) {
+  uint8_t *d = static_cast<uint8_t *>(dest);
+  const uint8_t *s = static_cast<const uint8_t *>(src);
+
+  if (!nt || size < 128) {
+    memcpy(d, s, size);
+    return;
+  }
+
+  size_t head = -reinterpret_cast<uintptr_t>(d) & 31;
+  memcpy(d, s, head);
+  d += head;
+  s += head;
+  size -= head;
+
+  size_t body = size & ~(size_t)63;
+  for (size_t i = 0; i < body; i += 64) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(s + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(s + i + 32));
+    _mm256_stream_si256((__m256i *)(d + i), a);
+    _mm256_stream_si256((__m256i *)(d + i + 32), b);
+  }
+  _mm_sfence();
+
+  memcpy(d + body, s + body, size - body);
+}
+
+__attribute__((target("avx2"))) inline void zeroAvx2(void *dest, size_t size,
+                                                     bool nt) {
+  uint8_t *d = static_cast<uint8_t *>(dest);
+
+  if (!nt || size < 128) {
+    memset(d, 0, size);
+    return;
+  }
+
+  size_t head = -reinterpret_cast<uintptr_t>(d) & 31;
+  memset(d, 0, head);
+  d += head;
+  size -= head;
+
+  __m256i z = _mm256_setzero_si256();
+  size_t body = size & ~(size_t)31;
+  for (size_t i = 0; i < body; i += 32)
+    _mm256_stream_si256((__m256i *)(d + i), z);
+  _mm_sfence();
+
+  memset(d + body, 0, size - body);
+}
+
+__attribute__((target("avx512f"))) inline void
+copyAvx512(void *dest, const void *src, size_t size, bool nt) {
+  uint8_t *d = static_cast<uint8_t *>(dest);
+  const uint8_t *s = static_cast<const uint8_t *>(src);
+
+  if (!nt || size < 256) {
+    memcpy(d, s, size);
+    return;
+  }
+
+  size_t head = -reinterpret_cast<uintptr_t>(d) & 63;
+  memcpy(d, s, head);
+  d += head;
+  s += head;
+  size -= head;
+
+  size_t body = size & ~(size_t)127;
+  for (size_t i = 0; i < body; i += 128) {
+    __m512i a = _mm512_loadu_si512(s + i);
+    __m512i b = _mm512_loadu_si512(s + i + 64);
+    _mm512_stream_si512((__m512i *)(d + i), a);
+    _mm512_stream_si512((__m512i *)(d + i + 64), b);
+  }
+  _mm_sfence();
+
+  memcpy(d + body, s + body, size - body);
+}
+
+__attribute__((target("avx512f"))) inline void
+zeroAvx512(void *dest, size_t size, bool nt) {
+  uint8_t *d = static_cast<uint8_t *>(dest);
+
+  if (!nt || size < 256) {
+    memset(d, 0, size);
+    return;
+  }
+
+  size_t head = -reinterpret_cast<uintptr_t>(d) & 63;
+  memset(d, 0, head);
+  d += head;
+  size -= head;
+
+  __m512i z = _mm512_setzero_si512();
+  size_t body = size & ~(size_t)63;
+  for (size_t i = 0; i < body; i += 64)
+    _mm512_stream_si512((__m512i *)(d + i), z);
+  _mm_sfence();
+
+  memset(d + body, 0, size - body);
+}
+
+#endif // __x86_64__
+
+struct CopyKernels {
+  CopyIsa isa;
+  size_t nt_threshold;
+  CopyKernel copy;
+  ZeroKernel zero;
+};
+
+inline const char *copyIsaName(CopyIsa isa) {
+  switch (isa) {
+  case CopyIsa::AVX2:
+    return "AVX2";
+  case CopyIsa::AVX512:
+    return "AVX512";
+  default:
+    return "GENERIC";
+  }
+}
+
+// Bytes of the last level cache per CPU sharing it, from sysfs, or 0 if
+// unknown.
+inline size_t llcSharePerThread() {
+  std::string dir = "/sys/devices/system/cpu/cpu0/cache/";
+  size_t share = 0;
+  int level = 0;
+
+  for (int i = 0;; ++i) {
+    std::string index = dir + "index" + std::to_string(i) + "/";
+    std::ifstream level_file(index + "level");
+    if (!level_file)
+      break;
+
+    int l = 0;
+    std::string type, size, cpus;
+    level_file >> l;
+    std::ifstream(index + "type") >> type;
+    std::ifstream(index + "size") >> size;
+    std::ifstream(index + "shared_cpu_list") >> cpus;
+    if (type == "Instruction" || l <= level || size.empty())
+      continue;
+
+    size_t bytes = std::stoul(size);
+    if (size.back() == 'K')
+      bytes *= 1024;
+    else if (size.back() == 'M')
+      bytes *= 1024 * 1024;
+
+    // shared_cpu_list is a list of ranges, e.g. 0-15,32-47
+    int sharing = 0;
+    size_t pos = 0;
+    while (pos < cpus.size()) {
+      size_t end = cpus.find(',', pos);
+      if (end == std::string::npos)
+        end = cpus.size();
+      std::string range = cpus.substr(pos, end - pos);
+      size_t dash = range.find('-');
+      sharing += dash == std::string::npos
+                     ? 1
+                     : std::stoi(range.substr(dash + 1)) -
+                           std::stoi(range.substr(0, dash)) + 1;
+      pos = end + 1;
+    }
+
+    level = l;
+    share = bytes / std::max(1, sharing);
+  }
+
+  return share;
+}
+
+inline CopyKernels selectCopyKernels() {
+  CopyKernels k = {CopyIsa::GENERIC, 0, copyGeneric, zeroGeneric};
+
+  size_t llc_share = llcSharePerThread();
+  size_t nt_default =
+      llc_share > 0 ? std::min<size_t>(std::max<size_t>(llc_share / 4 * 3,
+                                                        256 * 1024),
+                                       4 * 1024 * 1024)
+                    : 2 * 1024 * 1024;
+  k.nt_threshold =
+      alter_str_i(getconfig_c("KILT_COPY_NT_THRESHOLD"), nt_default);
+
+  CopyIsa best = CopyIsa::GENERIC;
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    best = CopyIsa::AVX512;
+  else if (__builtin_cpu_supports("avx2"))
+    best = CopyIsa::AVX2;
+#endif
+
+  CopyIsa isa = best;
+  std::string str = alter_str(getconfig_c("KILT_COPY_ISA"), std::string(""));
+  if (str == "GENERIC")
+    isa = CopyIsa::GENERIC;
+  else if (str == "AVX2")
+    isa = CopyIsa::AVX2;
+  else if (str == "AVX512")
+    isa = CopyIsa::AVX512;
+  else if (str != "")
+    throw std::invalid_argument("Unknown copy ISA " + str);
+
+  if (isa > best) {
+    std::cerr << "Copy ISA " << copyIsaName(isa)
+              << " not supported by this CPU, using " << copyIsaName(best)
+              << std::endl;
+    isa = best;
+  }
+
+  k.isa = isa;
+  std::cout << "Copy kernels: " << copyIsaName(isa) << ", streaming from "
+            << k.nt_threshold / 1024 << "KB" << std::endl;
+#if defined(__x86_64__)
+  if (isa == CopyIsa::AVX512) {
+    k.copy = copyAvx512;
+    k.zero = zeroAvx512;
+  } else if (isa == CopyIsa::AVX2) {
+    k.copy = copyAvx2;
+    k.zero = zeroAvx2;
+  }
+#endif
+
+  return k;
+}
+
+// Detected on first use and shared by all threads afterwards.
+inline const CopyKernels &copyKernels() {
+  static const CopyKernels k = selectCopyKernels();
+  return k;
+}
+
+inline void copyData(void *dest, const void *src, size_t size) {
+  const CopyKernels &k = copyKernels();
+  k.copy(dest, src, size, size >= k.nt_threshold);
+}
+
+inline void zeroData(void *dest, size_t size) {
+  const CopyKernels &k = copyKernels();
+  k.zero(dest, size, size >= k.nt_threshold);
+}
+
+} // namespace KRAI
+
+#endif // COPY_KERNELS_H
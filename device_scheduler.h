@@ -0,0 +1,294 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef DEVICE_SCHEDULER_H
+#define DEVICE_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include "idevice.h"
+#include "payload_pool.h"
+#include "spsc_ring.h"
+
+namespace KRAI {
+
+// Host buffer for a device without its own allocator, cache line aligned
+// and zeroed.
+inline void *allocHostBuffer(size_t size) {
+  size_t aligned = (size + 63) / 64 * 64;
+  void *b = aligned_alloc(64, aligned);
+  if (b == nullptr)
+    throw std::bad_alloc();
+  memset(b, 0, aligned);
+  return b;
+}
+
+// The free sets of one activation. A Payload needs `activation` and `set`
+// members, anything else in it is up to the device.
+template <typename Payload> class PayloadRing {
+public:
+  PayloadRing(int a, int s, ActivationMask *_mask) : free_sets(s) {
+    activation = a;
+    mask = _mask;
+    for (int i = 0; i < s; ++i) {
+      auto p = new Payload;
+      p->set = i;
+      p->activation = a;
+      payloads.push_back(p);
+    }
+    for (int i = s - 1; i >= 0; --i)
+      release(payloads[i]);
+  }
+
+  virtual ~PayloadRing() {
+    for (auto p : payloads)
+      delete p;
+  }
+
+  Payload *at(int set) { return payloads[set]; }
+
+  Payload *getPayload() {
+    int set = free_sets.pop();
+    if (set >= 0)
+      return payloads[set];
+
+    mask->clear(activation);
+    if (!free_sets.empty())
+      mask->set(activation);
+    return nullptr;
+  }
+
+  void release(Payload *p) {
+    free_sets.push(p->set);
+    mask->set(activation);
+  }
+
+private:
+  std::vector<Payload *> payloads;
+  IndexStack free_sets;
+  int activation;
+  ActivationMask *mask;
+};
+
+// Host side of a device that runs batches on a fixed set of payloads
+// (activation x set): Push() queues a batch, the scheduler thread takes the
+// next free payload round robin over the activations and hands it, with
+// `batch` and `enqueued` filled in, to the device's dispatch function. The
+// device calls Release() once it is finished with the payload.
+//
+// With spin_time >= 0 the scheduler spins then sleeps while it has nothing
+// to do, both for an empty queue and for all payloads busy; with
+// spin_time < 0 it polls every yield_time microseconds as before.
+template <typename Sample, typename Payload> class DeviceScheduler {
+public:
+  typedef void (*Dispatch)(void *handle, Payload *p);
+
+  DeviceScheduler(int activation_count, int set_count, int queue_depth,
+                  int yield_time, int spin_time, Dispatch _dispatch,
+                  void *_handle)
+      : free_activations(activation_count), samples_queue(queue_depth) {
+    scheduler_yield_time = yield_time;
+    scheduler_spin_time = spin_time;
+    dispatch = _dispatch;
+    handle = _handle;
+    for (int a = 0; a < activation_count; ++a)
+      ring_buf.push_back(
+          new PayloadRing<Payload>(a, set_count, &free_activations));
+  }
+
+  ~DeviceScheduler() {
+    Stop();
+    for (auto r : ring_buf)
+      delete r;
+  }
+
+  Payload *GetPayload(int activation, int set) {
+    return ring_buf[activation]->at(set);
+  }
+
+  void Start(int cpu) {
+    scheduler = std::thread(&DeviceScheduler::QueueScheduler, this);
+    if (cpu >= 0) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(cpu, &cpu_set);
+      pthread_setaffinity_np(scheduler.native_handle(), sizeof(cpu_set_t),
+                             &cpu_set);
+    }
+  }
+
+  // Stops the scheduler, a batch it is still holding is dropped. Payloads
+  // already dispatched are left to the device.
+  void Stop() {
+    if (!scheduler.joinable())
+      return;
+    scheduler_terminate = true;
+    samples_queue.wake();
+    {
+      std::lock_guard<std::mutex> lock(mtx_free);
+    }
+    cv_free.notify_all();
+    scheduler.join();
+  }
+
+  // Same contract as IDevice::Inference().
+  int Push(Batch<Sample> *batch) {
+    if (!samples_queue.push({batch, std::chrono::steady_clock::now()}))
+      return -1;
+
+    return samples_queue.getFreeSlots();
+  }
+
+  int GetFreeSlots() { return samples_queue.getFreeSlots(); }
+
+  void Release(Payload *p) {
+    ring_buf[p->activation]->release(p);
+
+    // pairs with the fence in WaitForPayload(): either the scheduler sees
+    // the payload in the mask or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (payload_waiting.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mtx_free);
+      cv_free.notify_one();
+    }
+
+    if (--payloads_in_flight == 0) {
+      std::lock_guard<std::mutex> lock(mtx_idle);
+      cv_idle.notify_all();
+    }
+  }
+
+  int GetInFlight() const { return payloads_in_flight; }
+
+  // Waits until every dispatched payload has been released, false on
+  // timeout.
+  bool WaitIdle(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mtx_idle);
+    return cv_idle.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                            [this] { return payloads_in_flight == 0; });
+  }
+
+private:
+  void QueueScheduler() {
+
+    // current activation index
+    int activation = -1;
+
+    QueuedBatch<Sample> qs;
+
+    while (!scheduler_terminate) {
+      if (!samples_queue.pop(qs)) {
+        // nothing queued - spin then sleep until Push() wakes us
+        if (scheduler_spin_time >= 0)
+          samples_queue.wait(scheduler_wait_timeout, scheduler_spin_time);
+        else if (scheduler_yield_time)
+          std::this_thread::sleep_for(
+              std::chrono::microseconds(scheduler_yield_time));
+        continue;
+      }
+
+      while (!scheduler_terminate) {
+
+        // next activation, round robin, that has a free payload
+        int next = free_activations.next(activation);
+
+        Payload *p = next < 0 ? nullptr : ring_buf[next]->getPayload();
+
+        // every set of every activation is busy
+        if (p == nullptr) {
+          if (next < 0)
+            WaitForPayload();
+          continue;
+        }
+
+        activation = next;
+
+        ++payloads_in_flight;
+
+        p->batch = qs.batch;
+        p->enqueued = qs.enqueued;
+
+        dispatch(handle, p);
+        break;
+      }
+    }
+  }
+
+  void WaitForPayload() {
+    if (scheduler_spin_time < 0) {
+      if (scheduler_yield_time)
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(scheduler_yield_time));
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx_free);
+    payload_waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!scheduler_terminate && free_activations.next(-1) < 0)
+      cv_free.wait_for(lock, std::chrono::microseconds(scheduler_wait_timeout));
+    payload_waiting.store(false, std::memory_order_relaxed);
+  }
+
+  std::vector<PayloadRing<Payload> *> ring_buf;
+  // activations with a free payload
+  ActivationMask free_activations;
+
+  SPSCRing<QueuedBatch<Sample>> samples_queue;
+
+  std::thread scheduler;
+  std::atomic<bool> scheduler_terminate{false};
+
+  Dispatch dispatch;
+  void *handle;
+
+  int scheduler_yield_time;
+  int scheduler_spin_time;
+  // upper bound on a blocking wait, so a wake racing with the terminate
+  // check cannot leave the scheduler asleep
+  static const int scheduler_wait_timeout = 10000;
+
+  // set while the scheduler sleeps for a free payload
+  std::atomic<bool> payload_waiting{false};
+  std::mutex mtx_free;
+  std::condition_variable cv_free;
+
+  // payloads dispatched and not yet released
+  std::atomic<int> payloads_in_flight{0};
+  std::mutex mtx_idle;
+  std::condition_variable cv_idle;
+};
+
+} // namespace KRAI
+
+#endif // DEVICE_SCHEDULER_H
@@ -0,0 +1,188 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef DEVICE_TELEMETRY_H
+#define DEVICE_TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include "mpsc_queue.h"
+
+namespace KRAI {
+
+// Counters for one activation of a device. All times are in microseconds.
+// Each activation gets its own cache lines, so the threads feeding
+// different activations do not contend on them.
+struct alignas(KILT_CACHE_LINE_SIZE) ActivationTelemetry {
+  std::atomic<int64_t> issued{0};    // batches handed to the hardware
+  std::atomic<int64_t> completed{0}; // batches the hardware finished
+  std::atomic<int64_t> samples{0};   // samples in the completed batches
+
+  // time with at least one batch executing
+  std::atomic<int64_t> busy_time{0};
+  std::atomic<int64_t> busy_since{0};
+  std::atomic<int> executing{0};
+
+  // sets held, and the time they were held summed over all of them - over
+  // the elapsed time this is the mean number of sets in use
+  std::atomic<int> sets_held{0};
+  std::atomic<int64_t> set_time{0};
+
+  // time batches waited for one of this activation's sets to come free
+  std::atomic<int64_t> set_wait_time{0};
+
+  // host time spent staging inputs into the sets
+  std::atomic<int64_t> staging_time{0};
+};
+
+// Utilisation and queueing counters of a device and its activations. Any
+// thread may update them and they can be read while the device runs.
+class DeviceTelemetry {
+public:
+  DeviceTelemetry(int activations, int sets)
+      : activation_count(activations), set_count(sets),
+        activations(new ActivationTelemetry[activations]),
+        start(std::chrono::steady_clock::now()) {}
+
+  ~DeviceTelemetry() { delete[] activations; }
+
+  // Microseconds since the device was created.
+  int64_t now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  // The scheduler took a batch off the device queue after it had waited
+  // there for wait_us.
+  void dequeued(int64_t wait_us) {
+    ++device.dequeued;
+    device.queue_wait_time += wait_us;
+  }
+
+  // A set of activation a was taken after the batch waited wait_us for it.
+  void acquired(int a, int64_t wait_us) {
+    ++activations[a].sets_held;
+    activations[a].set_wait_time += wait_us;
+  }
+
+  // A set of activation a was given back after being held for held_us.
+  void released(int a, int64_t held_us) {
+    --activations[a].sets_held;
+    activations[a].set_time += held_us;
+  }
+
+  void staged(int a, int64_t us) { activations[a].staging_time += us; }
+
+  // A batch was issued to activation a. The issue of a batch always happens
+  // before its completion, so busy_since is set before it is read.
+  void issued(int a) {
+    ActivationTelemetry &t = activations[a];
+    ++t.issued;
+    if (t.executing.fetch_add(1) == 0)
+      t.busy_since = now();
+  }
+
+  void completed(int a, int samples) {
+    ActivationTelemetry &t = activations[a];
+    ++t.completed;
+    t.samples += samples;
+    if (t.executing.fetch_sub(1) == 1)
+      t.busy_time += now() - t.busy_since;
+  }
+
+  int getActivationCount() const { return activation_count; }
+  int getSetCount() const { return set_count; }
+
+  const ActivationTelemetry &getActivation(int a) const {
+    return activations[a];
+  }
+
+  // Busy time of activation a, including a busy period still running.
+  int64_t getBusyTime(int a) const {
+    const ActivationTelemetry &t = activations[a];
+    int64_t busy = t.busy_time;
+    if (t.executing > 0)
+      busy += now() - t.busy_since;
+    return busy;
+  }
+
+  void print(std::ostream &os, int device_id) const {
+    int64_t elapsed = now();
+    if (elapsed <= 0)
+      return;
+
+    int64_t issued = 0, completed = 0, samples = 0, set_time = 0;
+    for (int a = 0; a < activation_count; ++a) {
+      issued += activations[a].issued;
+      completed += activations[a].completed;
+      samples += activations[a].samples;
+      set_time += activations[a].set_time;
+    }
+
+    os << std::fixed << std::setprecision(1);
+    os << "Telemetry device " << device_id << ": " << issued << " issued, "
+       << completed << " completed (" << samples << " samples) in "
+       << elapsed / 1000 << "ms, sets held " << (double)set_time / elapsed
+       << "/" << activation_count * set_count << ", queue wait mean "
+       << mean(device.queue_wait_time, device.dequeued) << "us" << std::endl;
+
+    for (int a = 0; a < activation_count; ++a) {
+      const ActivationTelemetry &t = activations[a];
+      os << "  activation " << a << ": " << t.issued << " issued, "
+         << t.completed << " completed, busy "
+         << 100.0 * getBusyTime(a) / elapsed << "%, sets held "
+         << (double)t.set_time / elapsed << "/" << set_count
+         << ", set wait mean " << mean(t.set_wait_time, t.issued)
+         << "us, staging mean " << mean(t.staging_time, t.issued) << "us"
+         << std::endl;
+    }
+    os << std::defaultfloat;
+  }
+
+private:
+  static double mean(int64_t total, int64_t count) {
+    return count > 0 ? (double)total / count : 0.0;
+  }
+
+  struct alignas(KILT_CACHE_LINE_SIZE) DeviceCounters {
+    std::atomic<int64_t> dequeued{0};
+    // time batches sat in the device queue before the scheduler took them
+    std::atomic<int64_t> queue_wait_time{0};
+  };
+
+  int activation_count;
+  int set_count;
+  ActivationTelemetry *activations;
+  DeviceCounters device;
+  std::chrono::time_point<std::chrono::steady_clock> start;
+};
+
+} // namespace KRAI
+
+#endif // DEVICE_TELEMETRY_H
@@ -0,0 +1,79 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef CPU_DEVICE_CONFIG_H
+#define CPU_DEVICE_CONFIG_H
+
+#include "config/config_tools/config_tools.h"
+#include "iconfig.h"
+
+namespace KRAI {
+
+class CpuDeviceConfig : public IDeviceConfig {
+
+public:
+  // Per device config
+  virtual const int getActivationCount() const { return cpu_activation_count; }
+  virtual const int getSetSize() const { return cpu_set_size; }
+  virtual const int getWorkerThreadCount() const { return cpu_worker_threads; }
+
+  virtual const int getSamplesQueueDepth() const { return samples_queue_depth; }
+
+  // Microseconds the scheduler sleeps while every set is busy.
+  virtual const int getSchedulerYieldTime() { return scheduler_yield_time; }
+  // Microseconds an idle scheduler spins before sleeping until the next
+  // batch arrives; negative keeps polling with the yield time instead.
+  // The default sleeps straight away, a CPU batch takes far longer than
+  // the wake-up.
+  virtual const int getSchedulerSpinTime() { return scheduler_spin_time; }
+
+  // Name of the per-batch compute function (see cpuComputeRegister()).
+  virtual const std::string getCompute() const { return cpu_compute; }
+
+private:
+  const int cpu_activation_count =
+      alter_str_i(getconfig_c("KILT_DEVICE_CPU_ACTIVATION_COUNT"), 1);
+
+  const int cpu_set_size =
+      alter_str_i(getconfig_c("KILT_DEVICE_CPU_QUEUE_LENGTH"), 4);
+
+  const int cpu_worker_threads =
+      alter_str_i(getconfig_c("KILT_DEVICE_CPU_WORKER_THREADS"), 1);
+
+  const int samples_queue_depth =
+      alter_str_i(getconfig_c("KILT_DEVICE_CPU_SAMPLES_QUEUE_DEPTH"), 8);
+
+  const int scheduler_yield_time =
+      alter_str_i(getconfig_c("KILT_DEVICE_CPU_SCHEDULER_YIELD_TIME"), 10);
+
+  const int scheduler_spin_time =
+      alter_str_i(getconfig_c("KILT_DEVICE_CPU_SCHEDULER_SPIN_TIME"), 0);
+
+  std::string cpu_compute =
+      alter_str(getconfig_c("KILT_DEVICE_CPU_COMPUTE"), std::string("NONE"));
+};
+
+IDeviceConfig *getDeviceConfig() { return new CpuDeviceConfig(); }
+
+}; // namespace KRAI
+#endif
@@ -0,0 +1,333 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef CPU_DEVICE_H
+#define CPU_DEVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "config/device_config.h"
+#include "device_scheduler.h"
+#include "idatasource.h"
+#include "imodel.h"
+
+using namespace KRAI;
+
+// Per-batch compute run by the CPU device between configureWorkload() and
+// postprocessResults(). It works on the host buffers of one activation/set,
+// sized from the model config for a full batch.
+typedef void (*CpuCompute)(void *handle, IModelConfig *model_cfg,
+                           int batch_size, std::vector<void *> &in_ptrs,
+                           std::vector<void *> &out_ptrs);
+
+struct CpuComputeEntry {
+  CpuCompute compute;
+  void *handle;
+};
+
+// Leaves the outputs as they are (zeroed at allocation).
+inline void cpuComputeNone(void *handle, IModelConfig *model_cfg,
+                           int batch_size, std::vector<void *> &in_ptrs,
+                           std::vector<void *> &out_ptrs) {}
+
+// Copies each input buffer into the output buffer with the same index, so
+// the data path can be checked end to end without a model.
+inline void cpuComputeCopy(void *handle, IModelConfig *model_cfg,
+                           int batch_size, std::vector<void *> &in_ptrs,
+                           std::vector<void *> &out_ptrs) {
+  for (int i = 0; i < in_ptrs.size() && i < out_ptrs.size(); ++i)
+    memcpy(out_ptrs[i], in_ptrs[i],
+           std::min(model_cfg->getInputByteSize(i),
+                    model_cfg->getOutputByteSize(i)));
+}
+
+inline std::map<std::string, CpuComputeEntry> &cpuComputeRegistry() {
+  static std::map<std::string, CpuComputeEntry> registry = {
+      {"NONE", {cpuComputeNone, nullptr}}, {"COPY", {cpuComputeCopy, nullptr}}};
+  return registry;
+}
+
+// Makes a compute function selectable by name via KILT_DEVICE_CPU_COMPUTE.
+// Must be called before the devices are created.
+inline void cpuComputeRegister(const std::string &name, CpuCompute compute,
+                               void *handle) {
+  cpuComputeRegistry()[name] = {compute, handle};
+}
+
+template <typename Sample> struct CpuPayload {
+  Batch<Sample> *batch;
+  std::chrono::time_point<std::chrono::steady_clock> enqueued;
+  int activation;
+  int set;
+};
+
+template <typename Sample> class CpuDevice : public IDevice<Sample> {
+
+  using State = typename IDevice<Sample>::State;
+
+public:
+  CpuDevice() : state(State::WAITING), total_execution_time(0) {}
+
+  void Construct(IModel *_model, IDataSource *_data_source, IConfig *_config,
+                 int hw_id, std::vector<int> aff) {
+    State s = State::READY;
+    try {
+      DeviceInit(_model, _data_source, _config, hw_id, aff);
+    } catch (const std::exception &e) {
+      std::cerr << "CPU device " << hw_id << ": " << e.what() << std::endl;
+      s = State::ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_ready);
+    state = s;
+    cv_ready.notify_all();
+  }
+
+  virtual State WaitReady() {
+    std::unique_lock<std::mutex> lock(mtx_ready);
+    cv_ready.wait(lock, [this] { return state != State::WAITING; });
+    return state;
+  }
+
+  virtual int Inference(Batch<Sample> *batch) {
+    return device_scheduler->Push(batch);
+  }
+
+  virtual int GetFreeSlots() { return device_scheduler->GetFreeSlots(); }
+
+  virtual State GetState() { return state; }
+
+  ~CpuDevice() {
+    if (device_scheduler) {
+      device_scheduler->Stop();
+
+      // let the workers finish the payloads already handed to them
+      if (!device_scheduler->WaitIdle(drain_timeout))
+        std::cout << "CPU device " << device_id << ": "
+                  << device_scheduler->GetInFlight()
+                  << " payloads still in flight at shutdown" << std::endl;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx_work);
+      workers_terminate = true;
+    }
+    cv_work.notify_all();
+    for (auto &w : workers)
+      w.join();
+
+    delete device_scheduler;
+
+    for (auto &a : buffers_in)
+      for (auto &s : a)
+        for (auto b : s)
+          free(b);
+    for (auto &a : buffers_out)
+      for (auto &s : a)
+        for (auto b : s)
+          free(b);
+
+    if (total_execution_time > 0)
+      std::cout << "Execution time on CPU device " << device_id << ": "
+                << total_execution_time / 1000 << "ms" << std::endl;
+  }
+
+private:
+  void DeviceInit(IModel *_model, IDataSource *_data_source, IConfig *_config,
+                  int hw_id, std::vector<int> aff) {
+
+    device_id = hw_id;
+
+    model = _model;
+    data_source = _data_source;
+
+    device_cfg = static_cast<CpuDeviceConfig *>(_config->device_cfg);
+    model_cfg = static_cast<IModelConfig *>(_config->model_cfg);
+
+    auto entry = cpuComputeRegistry().find(device_cfg->getCompute());
+    if (entry == cpuComputeRegistry().end())
+      throw std::invalid_argument("Unknown CPU compute function " +
+                                  device_cfg->getCompute());
+    compute = entry->second;
+
+    activation_count = device_cfg->getActivationCount();
+    drain_timeout = _config->server_cfg->getDrainTimeout();
+
+    std::cout << "Creating CPU device " << hw_id << std::endl;
+
+    // host buffers for every activation and set, sized for a full batch
+    int set_size = device_cfg->getSetSize();
+    buffers_in.resize(activation_count);
+    buffers_out.resize(activation_count);
+    for (int a = 0; a < activation_count; ++a) {
+      buffers_in[a].resize(set_size);
+      buffers_out[a].resize(set_size);
+      for (int s = 0; s < set_size; ++s) {
+        for (int i = 0; i < model_cfg->getInputCount(); ++i)
+          buffers_in[a][s].push_back(
+              allocHostBuffer(model_cfg->getInputByteSize(i)));
+        for (int o = 0; o < model_cfg->getOutputCount(); ++o)
+          buffers_out[a][s].push_back(
+              allocHostBuffer(model_cfg->getOutputByteSize(o)));
+      }
+    }
+
+    device_scheduler = new DeviceScheduler<Sample, CpuPayload<Sample>>(
+        activation_count, set_size, device_cfg->getSamplesQueueDepth(),
+        device_cfg->getSchedulerYieldTime(),
+        device_cfg->getSchedulerSpinTime(), &CpuDevice::Dispatch, this);
+
+    workers_terminate = false;
+
+    // the scheduler takes the last core, the workers share the rest
+    int scheduler_cpu = aff.empty() ? -1 : aff.back();
+    if (aff.size() > 1)
+      aff.pop_back();
+
+    for (int w = 0; w < device_cfg->getWorkerThreadCount(); ++w) {
+      workers.push_back(std::thread(&CpuDevice::Worker, this));
+      if (!aff.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(aff[w % aff.size()], &cpu_set);
+        pthread_setaffinity_np(workers.back().native_handle(),
+                               sizeof(cpu_set_t), &cpu_set);
+        std::cout << "Worker thread " << aff[w % aff.size()] << std::endl;
+      }
+    }
+
+    device_scheduler->Start(scheduler_cpu);
+    if (scheduler_cpu >= 0)
+      std::cout << "Scheduler thread " << scheduler_cpu << std::endl;
+  }
+
+  // Runs on the scheduler thread, hands the payload to the worker pool.
+  static void Dispatch(void *handle, CpuPayload<Sample> *p) {
+    CpuDevice *d = static_cast<CpuDevice *>(handle);
+    {
+      std::lock_guard<std::mutex> lock(d->mtx_work);
+      d->work.push_back(p);
+    }
+    d->cv_work.notify_one();
+  }
+
+  void Worker() {
+    while (true) {
+      CpuPayload<Sample> *p;
+      {
+        std::unique_lock<std::mutex> lock(mtx_work);
+        cv_work.wait(lock, [this] { return workers_terminate || !work.empty(); });
+        if (work.empty())
+          return;
+        p = work.front();
+        work.pop_front();
+      }
+      Execute(p);
+    }
+  }
+
+  void Execute(CpuPayload<Sample> *p) {
+    auto &in = buffers_in[p->activation][p->set];
+    auto &out = buffers_out[p->activation][p->set];
+
+    model->configureWorkload(data_source, this, &(p->batch->samples), in);
+
+    auto t_before = std::chrono::steady_clock::now();
+    compute.compute(compute.handle, model_cfg, p->batch->samples.size(), in,
+                    out);
+    total_execution_time +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t_before)
+            .count();
+
+    model->postprocessResults(&(p->batch->samples), out);
+
+    this->BatchCompleted(
+        p->batch->samples.size(),
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - p->enqueued)
+            .count());
+
+    p->batch->release();
+    device_scheduler->Release(p);
+  }
+
+  DeviceScheduler<Sample, CpuPayload<Sample>> *device_scheduler = nullptr;
+
+  // payloads handed from the scheduler to the worker pool
+  std::deque<CpuPayload<Sample> *> work;
+  std::mutex mtx_work;
+  std::condition_variable cv_work;
+  std::vector<std::thread> workers;
+  bool workers_terminate = false;
+
+  CpuDeviceConfig *device_cfg;
+  IModelConfig *model_cfg;
+
+  CpuComputeEntry compute;
+
+  // activation, set, input buffers
+  std::vector<std::vector<std::vector<void *>>> buffers_in;
+
+  // activation, set, output buffers
+  std::vector<std::vector<std::vector<void *>>> buffers_out;
+
+  IModel *model;
+  IDataSource *data_source;
+
+  int activation_count;
+
+  int device_id;
+
+  std::atomic<State> state;
+  std::mutex mtx_ready;
+  std::condition_variable cv_ready;
+
+  std::atomic<int64_t> total_execution_time;
+
+  int drain_timeout = 0;
+};
+
+template <typename Sample>
+IDevice<Sample> *createDevice(IModel *_model, IDataSource *_data_source,
+                              IConfig *_config, int hw_id,
+                              std::vector<int> aff) {
+  CpuDevice<Sample> *d = new CpuDevice<Sample>();
+
+  std::thread t(&CpuDevice<Sample>::Construct, d, _model, _data_source,
+                _config, hw_id, aff);
+  t.detach();
+
+  return d;
+}
+
+#endif // CPU_DEVICE_H
@@ -0,0 +1,158 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef QAIC_BUFFER_ARENA_H_
+#define QAIC_BUFFER_ARENA_H_
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+
+namespace qaic_api {
+
+// One allocation holding all the IO buffers of a device, carved up with a
+// bump allocator. It is backed by 2MB pages where the system has them
+// (hugetlbfs, else transparent hugepages), placed on the NUMA node of the
+// device's host cores, faulted in and locked so that neither the DMA nor
+// the host copies take TLB misses, page faults or remote accesses. The
+// placement is a preference, a node short of memory falls back on others.
+class BufferArena {
+public:
+  static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  BufferArena(size_t size, int numa_node, bool hugepages) : node(numa_node) {
+    capacity = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    if (hugepages) {
+      base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (base != MAP_FAILED)
+        backing = "hugetlbfs";
+    }
+    if (base == MAP_FAILED) {
+      base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (base == MAP_FAILED) {
+        base = nullptr;
+        return;
+      }
+      if (hugepages && madvise(base, capacity, MADV_HUGEPAGE) == 0)
+        backing = "transparent hugepages";
+    }
+
+    // place the pages before they are first touched
+    if (node >= 0 && !prefer(base, capacity, node))
+      node = -1;
+
+    memset(base, 0, capacity);
+    if (mlock(base, capacity) == 0)
+      locked = true;
+    else
+      lock_error = errno;
+  }
+
+  ~BufferArena() {
+    if (base != nullptr)
+      munmap(base, capacity);
+  }
+
+  bool valid() const { return base != nullptr; }
+
+  // errno of the failed mlock(), 0 if the arena is locked.
+  int lockError() const { return lock_error; }
+
+  size_t size() const { return capacity; }
+
+  // Returns nullptr once the arena is used up. align must be a power of 2.
+  void *allocate(size_t size, size_t align) {
+    size_t offset = (used + align - 1) & ~(align - 1);
+    if (base == nullptr || offset + size > capacity)
+      return nullptr;
+    used = offset + size;
+    return static_cast<uint8_t *>(base) + offset;
+  }
+
+  void print(std::ostream &os) const {
+    os << capacity / (1024 * 1024) << "MB, " << backing << ", NUMA node ";
+    if (node >= 0)
+      os << node;
+    else
+      os << "any";
+    os << (locked ? ", locked" : ", not locked") << std::endl;
+  }
+
+  // NUMA node of a CPU from sysfs, or -1 if unknown.
+  static int nodeOfCpu(int cpu) {
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr)
+      return -1;
+
+    int node = -1;
+    while (struct dirent *entry = readdir(dir)) {
+      if (strncmp(entry->d_name, "node", 4) == 0 &&
+          sscanf(entry->d_name + 4, "%d", &node) == 1)
+        break;
+      node = -1;
+    }
+    closedir(dir);
+    return node;
+  }
+
+private:
+  // mbind(2) through syscall(), so there is no dependency on libnuma.
+  static bool prefer(void *addr, size_t len, int node) {
+    const int MPOL_PREFERRED_ = 1;
+    const unsigned MPOL_MF_MOVE_ = 1 << 1;
+
+    unsigned long mask[16] = {0};
+    const int bits = 8 * sizeof(unsigned long);
+    if (node >= 16 * bits)
+      return false;
+    mask[node / bits] = 1UL << (node % bits);
+
+    return syscall(SYS_mbind, addr, len, MPOL_PREFERRED_, mask,
+                   16 * bits + 1, MPOL_MF_MOVE_) == 0;
+  }
+
+  void *base = MAP_FAILED;
+  size_t capacity;
+  size_t used = 0;
+  int node;
+  bool locked = false;
+  int lock_error = 0;
+  const char *backing = "4KB pages";
+};
+
+} // namespace qaic_api
+
+#endif // QAIC_BUFFER_ARENA_H_
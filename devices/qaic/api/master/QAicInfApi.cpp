@@ -31,6 +31,7 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "QAicInfApi.h"
+#include "QAicBufferArena.h"
 
 #include <dirent.h>
 #include <dlfcn.h>
@@ -39,8 +40,12 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <atomic>
 #include <unordered_map>
 #include <mutex>
 
@@ -52,9 +57,33 @@ const uint32_t numInferencesDefault = 40;
 const uint32_t numThreadsPerQueueDefault = 4;
 const uint32_t qidDefault = 0;
 
-std::unordered_map<std::string, std::pair<std::unique_ptr<uint8_t[]>, uint64_t>> model_file_cache;
+// A program file held for the runtime: mapped from the page cache, or a heap
+// copy when it cannot be mapped.
+struct LoadedFile {
+  uint8_t *data = nullptr;
+  size_t size = 0;
+  void *map = nullptr;
+  std::unique_ptr<uint8_t[]> heap;
+
+  ~LoadedFile() {
+    if (map != nullptr)
+      munmap(map, size);
+  }
+};
+
+std::unordered_map<std::string, std::unique_ptr<LoadedFile>> model_file_cache;
 std::mutex model_file_cache_lock;
 
+// QPCs opened so far, by model path, shared by every activation of every
+// device. The first user of a path loads and opens it; the others wait on
+// its future instead of opening it again. A failed open is reported as null
+// to those already waiting and dropped from the cache, so that a later
+// open retries it.
+std::unordered_map<std::string, std::shared_future<QAicQpcObj *>> qpc_cache;
+std::mutex qpc_mtx;
+// runners holding on to the cached QPCs
+int qpc_users = 0;
+
 class ActivationSet {
 
 public:
@@ -81,6 +110,18 @@ public:
   uint32_t getNumBuffers() { return numBuffers_; }
 
 private:
+  // What the completion callback of each set's event is registered with,
+  // once at init. run() only has to store the payload in it.
+  struct SetSlot {
+    ActivationSet *owner;
+    std::atomic<void *> payload;
+  };
+
+  static void setCallback(QAicEvent *event,
+                          QAicEventCompletionType eventCompletion,
+                          void *userData);
+
+  std::unique_ptr<SetSlot[]> setSlots_;
   std::vector<QAicEvent *> eventExecSet_;
   std::vector<QAicExecObj *> execObjSet_;
   std::vector<QBuffer *> qbuffersSet_;
@@ -148,6 +189,7 @@ QStatus ActivationSet::init(uint32_t setSize) {
   setSize_ = setSize;
 
   qbuffersSet_.resize(setSize_);
+  setSlots_.reset(new SetSlot[setSize_]);
 
   if (ppp_enable_) {
     //std::cout << "Zero Copy enabled" << std::endl;
@@ -184,10 +226,28 @@ QStatus ActivationSet::init(uint32_t setSize) {
       return status;
     }
     eventExecSet_.push_back(event);
+
+    setSlots_[i].owner = this;
+    setSlots_[i].payload = nullptr;
+    if (callback_ != nullptr) {
+      status = qaicEventAddCallback(event, setCallback, &setSlots_[i]);
+      if (status != QS_SUCCESS) {
+        std::cerr << "Failed to add event callback" << std::endl;
+        return status;
+      }
+    }
   }
   return QS_SUCCESS;
 }
 
+void ActivationSet::setCallback(QAicEvent *event,
+                                QAicEventCompletionType eventCompletion,
+                                void *userData) {
+  SetSlot *slot = static_cast<SetSlot *>(userData);
+  slot->owner->callback_(event, eventCompletion,
+                         slot->payload.load(std::memory_order_acquire));
+}
+
 QStatus ActivationSet::setData(std::vector<std::vector<QBuffer>> &buffers, std::vector<std::vector<QBufferDimensions>> &buffer_dims) {
   QStatus status = QS_SUCCESS;
   int i = 0;
@@ -235,17 +295,17 @@ QStatus ActivationSet::setDataSingle(int set_idx,
 QStatus ActivationSet::run(uint32_t index, void *payload, bool blocking) {
   QStatus status;
 
-  // std::cout << "clearing event for " << index << " " << payload << std::endl;
-  status = qaicEventClear(eventExecSet_.at(index));
-  if (status != QS_SUCCESS) {
-    return status;
-  }
-
-  qaicEventRemoveCallback(eventExecSet_.at(index), callback_);
+  // the event's callback was registered at init, it picks the payload up
+  // from the set's slot
+  setSlots_[index].payload.store(payload, std::memory_order_release);
 
-  status = qaicEventAddCallback(eventExecSet_.at(index), callback_, payload);
-  if (status != QS_SUCCESS) {
-    return status;
+  // only a blocking run waits on the event, so only then does it need to
+  // be reset first
+  if (blocking) {
+    status = qaicEventClear(eventExecSet_.at(index));
+    if (status != QS_SUCCESS) {
+      return status;
+    }
   }
 
   // std::cout << "Enqueuing work " << index << " " << payload << std::endl;
@@ -307,6 +367,20 @@ QAicInfApi::~QAicInfApi() {
 
   shActivationSets_.clear();
 
+  // the last runner out closes the shared QPCs
+  if (qpcUser_) {
+    std::scoped_lock lock(qpc_mtx);
+    if (--qpc_users == 0) {
+      for (auto &entry : qpc_cache)
+        if (entry.second.get() != nullptr)
+          qaicCloseQpc(entry.second.get());
+      qpc_cache.clear();
+
+      std::scoped_lock file_lock(model_file_cache_lock);
+      model_file_cache.clear();
+    }
+  }
+
   if (context_ != nullptr) {
     status = qaicReleaseContext(context_);
     if (status != QS_SUCCESS) {
@@ -316,6 +390,23 @@ QAicInfApi::~QAicInfApi() {
   }
 
   inferenceBufferVector_.clear();
+  arena_.reset();
+}
+
+void QAicInfApi::setProgramMapping(bool map, bool populate) {
+  mapProgram_ = map;
+  populateProgram_ = populate;
+}
+
+void QAicInfApi::setBufferArena(bool enable, bool hugepages, size_t alignment,
+                                int cpu) {
+  useArena_ = enable;
+  arenaHugepages_ = hugepages;
+  // at least a cache line, and a power of two
+  arenaAlignment_ = 64;
+  while (arenaAlignment_ < alignment)
+    arenaAlignment_ <<= 1;
+  arenaCpu_ = cpu;
 }
 
 void QAicInfApi::setSkipStage(std::string qaic_skip_stage) {
@@ -325,66 +416,177 @@ void QAicInfApi::setSkipStage(std::string qaic_skip_stage) {
   }
 }
 
-QStatus
-QAicInfApi::loadFileType(const std::string &filePath, size_t &sizeLoaded,
-                         uint8_t *&dataPtr) {
-  // Try checking the file cache first 
-  std::scoped_lock lock(model_file_cache_lock);
-  if (auto file = model_file_cache.find(filePath); file != model_file_cache.end()) {
-    dataPtr = file->second.first.get();
-    sizeLoaded = file->second.second;
-    return QS_SUCCESS;
-  } 
- 
+// Resident memory of the process from /proc/self/status, in kB.
+static int64_t readRss(const char *field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  size_t len = strlen(field);
+  while (std::getline(status, line))
+    if (line.compare(0, len, field) == 0 && line[len] == ':')
+      return atoll(line.c_str() + len + 1);
+  return 0;
+}
+
+// Map the file read-only so its pages come from (and stay in) the page
+// cache, shared with every other process using the same program.
+static std::unique_ptr<LoadedFile> mapFile(const std::string &filePath,
+                                           bool populate) {
+  int fd = open(filePath.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  int flags = MAP_PRIVATE | (populate ? MAP_POPULATE : 0);
+  void *map = mmap(nullptr, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return nullptr;
+
+  // the runtime reads the program front to back once, when it opens it
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  if (!populate)
+    madvise(map, st.st_size, MADV_WILLNEED);
+
+  std::unique_ptr<LoadedFile> file(new LoadedFile);
+  file->map = map;
+  file->data = static_cast<uint8_t *>(map);
+  file->size = st.st_size;
+  return file;
+}
+
+static std::unique_ptr<LoadedFile> readFile(const std::string &filePath) {
   uint64_t fileSize;
   std::ifstream infile;
   infile.open(filePath, std::ios::binary | std::ios::in);
   if (!infile.is_open()) {
     std::cerr << "Failed to open file: " << filePath << std::endl;
-    return QS_ERROR;
+    return nullptr;
   }
 
   infile.seekg(0, infile.end);
   fileSize = infile.tellg();
   infile.seekg(0, infile.beg);
-  std::unique_ptr<uint8_t[]> uniqueBuffer =
-      std::unique_ptr<uint8_t[]>(new (std::nothrow) uint8_t[fileSize]); //TODO: See if we can replace this with std::make_unique
-  if (uniqueBuffer == nullptr) {
+
+  std::unique_ptr<LoadedFile> file(new LoadedFile);
+  file->heap.reset(new (std::nothrow) uint8_t[fileSize]);
+  if (file->heap == nullptr) {
     std::cerr << "Failed to allocate buffer for file " << filePath
               << " of size " << fileSize << std::endl;
-    return QS_ERROR;
+    return nullptr;
   }
-  infile.read((char *)uniqueBuffer.get(), fileSize);
+  infile.read((char *)file->heap.get(), fileSize);
   if (!infile) {
     std::cerr << "Failed to read all data from file " << filePath << std::endl;
-    return QS_ERROR;
+    return nullptr;
+  }
+
+  file->data = file->heap.get();
+  file->size = fileSize;
+  return file;
+}
+
+QStatus
+QAicInfApi::loadFileType(const std::string &filePath, size_t &sizeLoaded,
+                         uint8_t *&dataPtr) {
+  // Try checking the file cache first 
+  {
+    std::scoped_lock lock(model_file_cache_lock);
+    if (auto file = model_file_cache.find(filePath); file != model_file_cache.end()) {
+      dataPtr = file->second->data;
+      sizeLoaded = file->second->size;
+      return QS_SUCCESS;
+    }
+  }
+
+  // read without the lock so that different files load in parallel
+  auto t_start = std::chrono::steady_clock::now();
+  int64_t anon = readRss("RssAnon");
+  int64_t mapped = readRss("RssFile");
+
+  std::unique_ptr<LoadedFile> file;
+  if (mapProgram_) {
+    file = mapFile(filePath, populateProgram_);
+    if (file == nullptr)
+      std::cerr << "Failed to map " << filePath << ", reading it instead"
+                << std::endl;
   }
+  if (file == nullptr)
+    file = readFile(filePath);
+  if (file == nullptr)
+    return QS_ERROR;
 
-  dataPtr = uniqueBuffer.get();
-  sizeLoaded = fileSize;
+  std::cout << "Loaded " << filePath << ": " << file->size / (1024 * 1024)
+            << "MB " << (file->map ? "mapped" : "read") << " in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - t_start)
+                   .count()
+            << "ms, RSS anon +" << (readRss("RssAnon") - anon) / 1024
+            << "MB, file +" << (readRss("RssFile") - mapped) / 1024 << "MB"
+            << std::endl;
 
-  // Save to the cache  
-  model_file_cache.emplace(filePath, std::make_pair(std::move(uniqueBuffer), fileSize));
+  // Save to the cache, unless another thread got there first
+  std::scoped_lock lock(model_file_cache_lock);
+  auto entry = model_file_cache.emplace(filePath, std::move(file));
+  dataPtr = entry.first->second->data;
+  sizeLoaded = entry.first->second->size;
   return QS_SUCCESS;
 }
 
-typedef std::pair<std::string, QAicQpcObj*> QPCEntry;
-std::vector<QPCEntry> qpc_map;
-std::mutex qpc_mtx;
+QStatus QAicInfApi::openQpc(const std::string &modelBasePath,
+                            QAicQpcObj *&qpc, bool &shared) {
+  std::promise<QAicQpcObj *> promise;
+  std::shared_future<QAicQpcObj *> future;
+  {
+    std::scoped_lock lock(qpc_mtx);
+    auto entry = qpc_cache.find(modelBasePath);
+    shared = entry != qpc_cache.end();
+    if (shared) {
+      future = entry->second;
+    } else {
+      future = promise.get_future().share();
+      qpc_cache.emplace(modelBasePath, future);
+    }
+  }
+
+  if (!shared) {
+    QBuffer programQpcBuf;
+    QAicQpcObj *opened = nullptr;
+
+    std::string filePath = modelBasePath + "/programqpc.bin";
+    if (loadFileType(filePath, programQpcBuf.size, programQpcBuf.buf) ==
+        QS_SUCCESS) {
+      if (qaicOpenQpc(&opened, programQpcBuf.buf, programQpcBuf.size,
+                      false) != QS_SUCCESS)
+        opened = nullptr;
+    }
 
-QAicQpcObj* getQPCEntry(std::string name) {
-  QAicQpcObj* qpc = nullptr;
-  for(int i=0 ; i<qpc_map.size() ; ++i) {
-    if(qpc_map[i].first == name) {
-      qpc = qpc_map[i].second;
-      break;
+    if (opened == nullptr) {
+      std::scoped_lock lock(qpc_mtx);
+      qpc_cache.erase(modelBasePath);
     }
+    promise.set_value(opened);
   }
-  return qpc;
+
+  qpc = future.get();
+  if (qpc == nullptr) {
+    std::cerr << "Failed to open Qpc." << std::endl;
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
 }
 
-void setQPCEntry(std::string name, QAicQpcObj* qpc) {
-  qpc_map.push_back(QPCEntry(name, qpc));
+void QAicInfApi::markPhase(const std::string &phase) {
+  auto now = std::chrono::steady_clock::now();
+  startupTimeline_.emplace_back(
+      phase,
+      std::chrono::duration_cast<std::chrono::microseconds>(now - phaseStart_)
+          .count());
+  phaseStart_ = now;
 }
 
 QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
@@ -394,6 +596,15 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
   callback_ = callback;
   // std::cout << "callback - " << (void*)callback_ << std::endl;
 
+  startupTimeline_.clear();
+  phaseStart_ = std::chrono::steady_clock::now();
+
+  {
+    std::scoped_lock lock(qpc_mtx);
+    ++qpc_users;
+    qpcUser_ = true;
+  }
+
   dev_ = qid;
 
   // validate if device is available
@@ -436,24 +647,13 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
     return status;
   }
 
+  markPhase("context");
+
+  bool qpcShared = true;
   for (uint32_t i = 0; i < modelBasePaths_.size(); i++) {
 
-    QBuffer programQpcBuf_;
     QAicProgramProperties_t programProperties_;
 
-    std::vector<std::unique_ptr<uint8_t[]>> programBufferVector_;
-
-    qpc_mtx.lock();
-
-    QAicQpcObj *qpcObj_ = nullptr; //getQPCEntry(modelBasePaths_[i]);
-
-    if(qpcObj_ == nullptr) {
-
-    std::string filePath = modelBasePaths_[i] + "/programqpc.bin";
-
-    // Load file
-    status = loadFileType(filePath, programQpcBuf_.size, programQpcBuf_.buf);
-
     //-------------------------------------------------------------------------
     // Create Programs
     // It is valid to pass a null for constants, if null program will
@@ -468,18 +668,12 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
       return status;
     }
 
-    status =
-        qaicOpenQpc(&qpcObj_, programQpcBuf_.buf, programQpcBuf_.size, false);
-    if (status != QS_SUCCESS) {
-      std::cerr << "Failed to open Qpc." << std::endl;
+    QAicQpcObj *qpcObj_ = nullptr;
+    bool shared;
+    status = openQpc(modelBasePaths_[i], qpcObj_, shared);
+    if (status != QS_SUCCESS)
       return status;
-    }
-
-    setQPCEntry(modelBasePaths_[i], qpcObj_);
-
-    }
-
-    qpc_mtx.unlock();
+    qpcShared &= shared;
 
     const char *name = "progName";
     QAicProgram *program = nullptr;
@@ -494,6 +688,9 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
     programs_.push_back(program);
   }
 
+  // time spent opening the QPC, or waiting for another runner to
+  markPhase(qpcShared ? "qpc (shared)" : "qpc");
+
   //-------------------------------------------------------------------------
   // Load Programs  QAicInfApi(uint32_t dummy);
 
@@ -501,30 +698,35 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
   // the program when it is needed.
   // For this reason the following code is commented out, to demonstrate
   // automatic loading and activation
-  //-------------------------------------------------------------------------
-  for (uint32_t i = 0; i < modelBasePaths_.size(); i++) {
-    QStatus status;
-    status = qaicLoadProgram(programs_[i]);
-    if (status != QS_SUCCESS) {
-      std::cerr << "Failed to load program" << std::endl;
-      return status;
-    }
-  }
-  //-------------------------------------------------------------------------
   // Activate Programs
-  // User may choose to explicitly activate program, or let the driver
-  // activate the program when it is needed.
-  // For this reason the following code is commented out, to demonstrate
-  // automatic loading and activation
+  // Each activation loads and activates its program on its own thread, so
+  // the card works on all of them at once rather than one after another.
   //-------------------------------------------------------------------------
+  std::vector<std::future<QStatus>> activations;
   for (uint32_t i = 0; i < modelBasePaths_.size(); i++) {
-    QStatus status;
-    status = qaicRunActivationCmd(programs_[i], QAIC_PROGRAM_CMD_ACTIVATE_FULL);
-    if (status != QS_SUCCESS) {
-      std::cerr << "Failed to enqueue Activation command" << std::endl;
+    activations.push_back(std::async(std::launch::async, [this, i] {
+      QStatus status;
+      status = qaicLoadProgram(programs_[i]);
+      if (status != QS_SUCCESS) {
+        std::cerr << "Failed to load program" << std::endl;
+        return status;
+      }
+      status =
+          qaicRunActivationCmd(programs_[i], QAIC_PROGRAM_CMD_ACTIVATE_FULL);
+      if (status != QS_SUCCESS)
+        std::cerr << "Failed to enqueue Activation command" << std::endl;
       return status;
-    }
+    }));
   }
+  for (auto &a : activations) {
+    QStatus activation_status = a.get();
+    if (activation_status != QS_SUCCESS)
+      status = activation_status;
+  }
+  if (status != QS_SUCCESS)
+    return status;
+
+  markPhase("load+activate");
 
   //-------------------------------------------------------------------------
   // Create Queues for Execution
@@ -540,6 +742,12 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
     queues_.push_back(queue);
   }
 
+  markPhase("queues");
+
+  // selected IO set and activation set of every activation
+  std::vector<aicapi::IoDesc> activationIoDescs;
+  std::vector<std::shared_ptr<ActivationSet>> activationSets;
+
   for (uint32_t i = 0; i < modelBasePaths_.size(); i++) {
 
     QData ioDescQData;
@@ -620,8 +828,18 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
       shActivationSets_.emplace_back(shActivation);
     }
 
-    // Create IO buffers
-    status = createBuffers(i, ioDescProto, shActivation);
+    activationIoDescs.push_back(ioDescProto);
+    activationSets.push_back(shActivation);
+  }
+
+  // The arena holds the buffers of every activation, so it is sized once
+  // all their IO descriptors are known.
+  if (useArena_ && !ppp_enable_)
+    createBufferArena(activationIoDescs);
+
+  // Create IO buffers
+  for (uint32_t i = 0; i < modelBasePaths_.size(); i++) {
+    status = createBuffers(i, activationIoDescs[i], activationSets[i]);
     if (status != QS_SUCCESS) {
       std::cerr << "Failed to create IO buffers." << std::endl;
       return status;
@@ -632,6 +850,8 @@ QStatus QAicInfApi::init(QID qid, QAicEventCallback callback,
     setData();
   }
 
+  markPhase("buffers");
+
   return QS_SUCCESS;
 }
 
@@ -766,23 +986,14 @@ QStatus QAicInfApi::createBuffers(int idx, aicapi::IoDesc &ioDescProto,
         QBuffer buf;
         uint32_t outputBufferSize =
             ioDescProto.selected_set().bindings(i).size();
-        std::unique_ptr<uint8_t[]> uniqueBuffer = std::unique_ptr<uint8_t[]>(
-            // over allocate to allow for buffer alignment
-            new (std::nothrow) uint8_t[outputBufferSize + 32]);
-        if (uniqueBuffer == nullptr) {
+        buf.buf = allocateBuffer(outputBufferSize);
+        if (buf.buf == nullptr) {
           std::cerr << "Failed to allocate buffer for output, size "
                     << outputBufferSize << std::endl;
           return QS_ERROR;
         }
-        buf.buf = uniqueBuffer.get();
-
-        // align the buffer to 32 byte boundary
-        uint64_t mask = 31;
-        mask = ~mask;
-        buf.buf = (uint8_t *)((uint64_t)(buf.buf + 32) & mask);
 
         buf.size = outputBufferSize;
-        inferenceBufferVector_.push_back(std::move(uniqueBuffer));
         inferenceBuffersList_[idx][y].push_back(std::move(buf));
       } else if (ioDescProto.selected_set().bindings(i).dir() ==
                  aicapi::BUFFER_IO_TYPE_INPUT) {
@@ -790,22 +1001,13 @@ QStatus QAicInfApi::createBuffers(int idx, aicapi::IoDesc &ioDescProto,
         uint32_t inputBufferSize =
             ioDescProto.selected_set().bindings(i).size();
 
-        std::unique_ptr<uint8_t[]> uniqueBuffer = std::unique_ptr<uint8_t[]>(
-            // over allocate to allow for buffer alignment
-            new (std::nothrow) uint8_t[inputBufferSize + 32]);
-        if (uniqueBuffer == nullptr) {
+        buf.buf = allocateBuffer(inputBufferSize);
+        if (buf.buf == nullptr) {
           std::cerr << "Failed to allocate input buffer" << std::endl;
           return QS_ERROR;
         }
-        buf.buf = uniqueBuffer.get();
-
-        // align the buffer to 32 byte boundary
-        uint64_t mask = 31;
-        mask = ~mask;
-        buf.buf = (uint8_t *)((uint64_t)(buf.buf + 32) & mask);
 
         buf.size = inputBufferSize;
-        inferenceBufferVector_.push_back(std::move(uniqueBuffer));
         inferenceBuffersList_[idx][y].push_back(std::move(buf));
       }
     }
@@ -814,6 +1016,59 @@ QStatus QAicInfApi::createBuffers(int idx, aicapi::IoDesc &ioDescProto,
   return QS_SUCCESS;
 }
 
+void QAicInfApi::createBufferArena(
+    const std::vector<aicapi::IoDesc> &ioDescs) {
+  size_t size = 0;
+  for (auto &ioDesc : ioDescs)
+    for (auto &binding : ioDesc.selected_set().bindings())
+      size += (binding.size() + arenaAlignment_ - 1) & ~(arenaAlignment_ - 1);
+  size *= setSize_;
+
+  int node = arenaCpu_ >= 0 ? BufferArena::nodeOfCpu(arenaCpu_) : -1;
+  arena_.reset(new BufferArena(size, node, arenaHugepages_));
+  if (!arena_->valid()) {
+    std::cerr << "Failed to create buffer arena on device " << dev_
+              << ", allocating buffers separately" << std::endl;
+    arena_.reset();
+    useArena_ = false;
+    return;
+  }
+
+  std::cout << "Buffer arena on device " << dev_ << ": ";
+  arena_->print(std::cout);
+
+  // the buffers still work, but may be paged out or moved under the DMA
+  if (arena_->lockError() != 0)
+    std::cerr << "WARNING: could not lock the " << arena_->size() / 1024
+              << "KB buffer arena of device " << dev_ << " in memory ("
+              << strerror(arena_->lockError())
+              << "), raise the locked memory limit (ulimit -l)" << std::endl;
+}
+
+uint8_t *QAicInfApi::allocateBuffer(size_t size) {
+  if (arena_ != nullptr) {
+    void *buf = arena_->allocate(size, arenaAlignment_);
+    if (buf != nullptr)
+      return static_cast<uint8_t *>(buf);
+    std::cerr << "Buffer arena on device " << dev_
+              << " is full, allocating separately" << std::endl;
+  }
+
+  std::unique_ptr<uint8_t[]> uniqueBuffer = std::unique_ptr<uint8_t[]>(
+      // over allocate to allow for buffer alignment
+      new (std::nothrow) uint8_t[size + 32]);
+  if (uniqueBuffer == nullptr)
+    return nullptr;
+
+  // align the buffer to 32 byte boundary
+  uint64_t mask = 31;
+  mask = ~mask;
+  uint8_t *buf = (uint8_t *)((uint64_t)(uniqueBuffer.get() + 32) & mask);
+
+  inferenceBufferVector_.push_back(std::move(uniqueBuffer));
+  return buf;
+}
+
 QStatus QAicInfApi::deleteBuffers(int act_idx, int set_idx, std::vector<int> delete_list) {
 
   for( int i=0 ; i<delete_list.size() ; ++i) {
@@ -925,8 +1180,6 @@ QStatus QAicInfApi::deinit() {
     }
   }
 
-  model_file_cache.clear();
-
   return QS_SUCCESS;
 }
 
@@ -52,6 +52,8 @@
 
 namespace qaic_api {
 
+class BufferArena;
+
 extern const uint32_t setSizeDefault;
 extern const uint32_t numActivationsDefault;
 extern const uint32_t numInferencesDefault;
@@ -82,6 +84,13 @@ public:
   void setSetSize(uint32_t num);
   void setLibPath(std::string &aicLibPath);
   void setSkipStage(std::string qaic_skip_stage);
+  // Map programqpc.bin rather than read it into memory, optionally
+  // faulting it all in up front.
+  void setProgramMapping(bool map, bool populate);
+  // Allocate the IO buffers from one arena, optionally on 2MB pages, with
+  // each buffer aligned to alignment bytes and the memory placed on the
+  // NUMA node of cpu (-1 for no placement).
+  void setBufferArena(bool enable, bool hugepages, size_t alignment, int cpu);
   // Initialize Driver, Run, De-Init, get Results
 
   QStatus init(QID qid, QAicEventCallback callback,
@@ -111,9 +120,19 @@ public:
   QStatus setBufferPtr(uint32_t act_idx, uint32_t set_idx, uint32_t buf_idx,
                        void *ptr);
 
+  // Phases of the last init() and the microseconds each took.
+  const std::vector<std::pair<std::string, int64_t>> &getStartupTimeline() const {
+    return startupTimeline_;
+  }
+
 private:
   QStatus loadFileType(const std::string &filePath, size_t &sizeLoaded,
                        uint8_t *&dataPtr);
+  QStatus openQpc(const std::string &modelBasePath, QAicQpcObj *&qpc,
+                  bool &shared);
+  void markPhase(const std::string &phase);
+  void createBufferArena(const std::vector<aicapi::IoDesc> &ioDescs);
+  uint8_t *allocateBuffer(size_t size);
   QAicContext *context_;
   QAicConstants *constants_;
   std::vector<QAicProgram *> programs_;
@@ -154,6 +173,21 @@ private:
 
   bool ppp_enable_;
 
+  // Holds a reference on the shared QPC cache.
+  bool qpcUser_ = false;
+
+  bool mapProgram_ = true;
+  bool populateProgram_ = true;
+
+  std::unique_ptr<BufferArena> arena_;
+  bool useArena_ = false;
+  bool arenaHugepages_ = true;
+  size_t arenaAlignment_ = 64;
+  int arenaCpu_ = -1;
+
+  std::vector<std::pair<std::string, int64_t>> startupTimeline_;
+  std::chrono::time_point<std::chrono::steady_clock> phaseStart_;
+
 }; // QAicInfApi
 
 } // namespace qaic_api
@@ -0,0 +1,189 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef QAIC_STUB_API_H_
+#define QAIC_STUB_API_H_
+
+// Stand-in for the QAIC runtime header, declaring the part of the runtime
+// API that QAicInfApi uses. Built together with QAicApiStub.cpp it replaces
+// libQAic so the QAicInfApi/Device path can run without cards:
+//
+//   g++ ... -Idevices/qaic/api/stub devices/qaic/api/master/QAicInfApi.cpp
+//       devices/qaic/api/stub/QAicApiStub.cpp
+//
+// in place of the SDK include path and library. See QAicApiStub.cpp for the
+// program format and the latency settings.
+
+#include <cstddef>
+#include <cstdint>
+
+#define LRT_LIB_MAJOR_VERSION 1
+#define LRT_LIB_MINOR_VERSION 0
+
+typedef enum {
+  QS_SUCCESS = 0,
+  QS_ERROR,
+  QS_INVAL,
+  QS_NOMEM,
+  QS_AGAIN,
+  QS_UNSUPPORTED
+} QStatus;
+
+typedef uint32_t QID;
+typedef uint32_t QAicContextID;
+
+typedef enum { QL_DEBUG, QL_INFO, QL_WARN, QL_ERROR } QLogLevel;
+typedef enum { QAIC_ERROR_RUNTIME, QAIC_ERROR_DEVICE } QAicErrorType;
+
+typedef struct {
+  size_t size;
+  uint8_t *buf;
+} QBuffer;
+
+typedef struct {
+  size_t size;
+  uint8_t *data;
+} QData;
+
+typedef struct {
+  uint32_t count;
+  uint32_t *dims;
+  uint32_t sizeOfElem;
+} QBufferDimensions;
+
+typedef enum { QDS_READY, QDS_ERROR } QDevStatus;
+
+typedef struct {
+  QDevStatus devStatus;
+} QDevInfo;
+
+typedef struct QAicContext QAicContext;
+typedef struct QAicConstants QAicConstants;
+typedef struct QAicProgram QAicProgram;
+typedef struct QAicQueue QAicQueue;
+typedef struct QAicEvent QAicEvent;
+typedef struct QAicExecObj QAicExecObj;
+typedef struct QAicQpcObj QAicQpcObj;
+
+typedef uint32_t QAicContextProperties_t;
+typedef uint32_t QAicConstantsProperties_t;
+typedef uint32_t QAicExecObjProperties_t;
+
+#define QAIC_CONTEXT_DEFAULT 0
+#define QAIC_EXECOBJ_PROPERTIES_DEFAULT 0
+#define QAIC_EXECOBJ_PROPERTIES_ZERO_COPY_BUFFERS 1
+#define QAIC_QUEUE_PROPERTIES_ENABLE_MULTI_THREADED_QUEUES 1
+
+typedef struct {
+  uint32_t flags;
+  uint32_t numThreadsPerQueue;
+} QAicQueueProperties;
+
+typedef struct {
+  uint32_t SubmitRetryTimeoutMs;
+} QAicProgramProperties_t;
+
+typedef enum {
+  QAIC_EVENT_DEVICE_COMPLETE,
+  QAIC_EVENT_DEVICE_ERROR
+} QAicEventCompletionType;
+
+typedef enum {
+  QAIC_PROGRAM_CMD_ACTIVATE_FULL,
+  QAIC_PROGRAM_CMD_DEACTIVATE_FULL
+} QAicProgramActivationCmd;
+
+typedef void (*QAicEventCallback)(QAicEvent *event,
+                                  QAicEventCompletionType completion,
+                                  void *userData);
+typedef void (*QAicLogCallback)(QLogLevel level, const char *str,
+                                void *userData);
+typedef void (*QAicErrorHandler)(QAicContextID id, const char *errInfo,
+                                 QAicErrorType errType, const void *errData,
+                                 size_t errDataSize, void *userData);
+
+typedef struct {
+  QStatus (*qaicExecObjGetIoBuffers)(const QAicExecObj *execObj,
+                                     uint32_t *numBuffers, QBuffer **buffers);
+} QAicApiFunctionTable;
+
+extern "C" {
+
+const QAicApiFunctionTable *qaicGetFunctionTable();
+
+QStatus qaicGetDeviceInfo(QID dev, QDevInfo *info);
+QStatus qaicGetAicVersion(uint16_t *major, uint16_t *minor, const char **patch,
+                          const char **variant);
+
+QStatus qaicCreateContext(QAicContext **context,
+                          QAicContextProperties_t *properties,
+                          uint32_t numDevices, QID *devices,
+                          QAicLogCallback logCallback, void *logUserData,
+                          QAicErrorHandler errorHandler, void *errUserData);
+QStatus qaicReleaseContext(QAicContext *context);
+
+QStatus qaicProgramPropertiesInitDefault(QAicProgramProperties_t *properties);
+QStatus qaicOpenQpc(QAicQpcObj **qpc, const uint8_t *buf, size_t size,
+                    bool copy);
+QStatus qaicCloseQpc(QAicQpcObj *qpc);
+
+QStatus qaicCreateProgram(QAicContext *context, QAicProgram **program,
+                          QAicProgramProperties_t *properties, QID dev,
+                          const char *name, QAicQpcObj *qpc);
+QStatus qaicReleaseProgram(QAicProgram *program);
+QStatus qaicLoadProgram(QAicProgram *program);
+QStatus qaicUnloadProgram(QAicProgram *program);
+QStatus qaicRunActivationCmd(QAicProgram *program,
+                             QAicProgramActivationCmd cmd);
+QStatus qaicProgramGetIoDescriptor(const QAicProgram *program, QData *ioDesc);
+
+QStatus qaicReleaseConstants(QAicConstants *constants);
+
+QStatus qaicCreateQueue(QAicContext *context, QAicQueue **queue,
+                        QAicQueueProperties *properties, QID dev);
+QStatus qaicReleaseQueue(QAicQueue *queue);
+
+QStatus qaicCreateExecObj(QAicContext *context, QAicExecObj **execObj,
+                          const QAicExecObjProperties_t *properties,
+                          const QAicProgram *program, const QData *ioDesc,
+                          const QData *reserved0, const QData *reserved1);
+QStatus qaicReleaseExecObj(QAicExecObj *execObj);
+QStatus qaicExecObjSetDataExt(QAicExecObj *execObj, uint32_t numBuffers,
+                              const QBuffer *buffers,
+                              const QBufferDimensions *dims);
+
+QStatus qaicCreateEvent(QAicContext *context, QAicEvent **event,
+                        QAicEventCompletionType type);
+QStatus qaicReleaseEvent(QAicEvent *event);
+QStatus qaicEventClear(QAicEvent *event);
+QStatus qaicEventAddCallback(QAicEvent *event, QAicEventCallback callback,
+                             void *userData);
+QStatus qaicEventRemoveCallback(QAicEvent *event, QAicEventCallback callback);
+QStatus qaicWaitforEvent(QAicEvent *event);
+
+QStatus qaicEnqueueExecObj(QAicQueue *queue, QAicExecObj *execObj,
+                           QAicEvent *event);
+}
+
+#endif // QAIC_STUB_API_H_
@@ -0,0 +1,243 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef QAIC_STUB_API_PB_H_
+#define QAIC_STUB_API_PB_H_
+
+// Stand-in for the IO descriptor protobuf of the QAIC runtime, with the
+// accessors QAicInfApi uses. Instead of the protobuf wire format it reads
+// and writes the stub program text format (see QAicApiStub.cpp):
+//
+//   set <name>
+//   <binding name> <in|out> <type> <dim>,<dim>,...
+//
+// Binding lines before the first set line belong to a set named "default".
+// The first set is the selected one.
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace aicapi {
+
+enum bufferIoTypeEnum { BUFFER_IO_TYPE_INPUT, BUFFER_IO_TYPE_OUTPUT };
+
+enum bufferIoDataTypeEnum {
+  FLOAT_TYPE,
+  FLOAT_16_TYPE,
+  INT8_Q_TYPE,
+  INT16_Q_TYPE,
+  INT32_I_TYPE,
+  INT64_I_TYPE,
+  INT8_TYPE
+};
+
+class IoBinding {
+public:
+  const std::string &name() const { return name_; }
+  bufferIoTypeEnum dir() const { return dir_; }
+  bufferIoDataTypeEnum type() const { return type_; }
+  const std::vector<uint32_t> &dims() const { return dims_; }
+
+  // Size of the buffer in bytes.
+  uint32_t size() const {
+    uint32_t size = elementSize(type_);
+    for (uint32_t d : dims_)
+      size *= d;
+    return size;
+  }
+
+  static uint32_t elementSize(bufferIoDataTypeEnum type) {
+    switch (type) {
+    case FLOAT_TYPE:
+    case INT32_I_TYPE:
+      return 4;
+    case FLOAT_16_TYPE:
+    case INT16_Q_TYPE:
+      return 2;
+    case INT64_I_TYPE:
+      return 8;
+    default:
+      return 1;
+    }
+  }
+
+  bool parse(const std::string &line) {
+    std::istringstream ss(line);
+    std::string dir, type, dims;
+    if (!(ss >> name_ >> dir >> type >> dims))
+      return false;
+
+    if (dir == "in")
+      dir_ = BUFFER_IO_TYPE_INPUT;
+    else if (dir == "out")
+      dir_ = BUFFER_IO_TYPE_OUTPUT;
+    else
+      return false;
+
+    if (!parseType(type))
+      return false;
+
+    std::istringstream ss_dims(dims);
+    std::string d;
+    dims_.clear();
+    while (std::getline(ss_dims, d, ','))
+      dims_.push_back(std::stoul(d));
+    return !dims_.empty();
+  }
+
+  void serialize(std::ostream &os) const {
+    static const char *types[] = {"FLOAT32", "FLOAT16", "UINT8", "INT16",
+                                  "INT32",   "INT64",   "INT8"};
+    os << name_ << (dir_ == BUFFER_IO_TYPE_INPUT ? " in " : " out ")
+       << types[type_] << " ";
+    for (size_t i = 0; i < dims_.size(); ++i)
+      os << (i ? "," : "") << dims_[i];
+    os << "\n";
+  }
+
+private:
+  // Accepts the KILT model format type names.
+  bool parseType(const std::string &type) {
+    if (type == "FLOAT32")
+      type_ = FLOAT_TYPE;
+    else if (type == "FLOAT16" || type == "HALF")
+      type_ = FLOAT_16_TYPE;
+    else if (type == "INT8")
+      type_ = INT8_TYPE;
+    else if (type == "UINT8")
+      type_ = INT8_Q_TYPE;
+    else if (type == "INT16" || type == "UINT16")
+      type_ = INT16_Q_TYPE;
+    else if (type == "INT32" || type == "UINT32")
+      type_ = INT32_I_TYPE;
+    else if (type == "INT64" || type == "UINT64")
+      type_ = INT64_I_TYPE;
+    else
+      return false;
+    return true;
+  }
+
+  std::string name_;
+  bufferIoTypeEnum dir_ = BUFFER_IO_TYPE_INPUT;
+  bufferIoDataTypeEnum type_ = FLOAT_TYPE;
+  std::vector<uint32_t> dims_;
+};
+
+class IoSet {
+public:
+  const std::string &name() const { return name_; }
+  void set_name(const std::string &name) { name_ = name; }
+
+  const std::vector<IoBinding> &bindings() const { return bindings_; }
+  const IoBinding &bindings(int i) const { return bindings_.at(i); }
+  std::vector<IoBinding> *mutable_bindings() { return &bindings_; }
+
+  void CopyFrom(const IoSet &other) { *this = other; }
+
+  void serialize(std::ostream &os) const {
+    os << "set " << name_ << "\n";
+    for (const IoBinding &b : bindings_)
+      b.serialize(os);
+  }
+
+private:
+  std::string name_;
+  std::vector<IoBinding> bindings_;
+};
+
+class IoDesc {
+public:
+  const IoSet &selected_set() const { return selected_set_; }
+  IoSet *mutable_selected_set() { return &selected_set_; }
+  void clear_selected_set() { selected_set_ = IoSet(); }
+
+  const std::vector<IoSet> &io_sets() const { return io_sets_; }
+
+  // The zero copy path gets one buffer per binding.
+  uint32_t dma_buf_size() const { return selected_set_.bindings().size(); }
+
+  bool ParseFromArray(const void *data, int size) {
+    io_sets_.clear();
+    std::istringstream ss(
+        std::string(static_cast<const char *>(data), size));
+    std::string line;
+    while (std::getline(ss, line)) {
+      size_t start = line.find_first_not_of(" \t\r");
+      if (start == std::string::npos || line[start] == '#')
+        continue;
+      line = line.substr(start);
+
+      if (line.compare(0, 4, "set ") == 0) {
+        io_sets_.emplace_back();
+        io_sets_.back().set_name(line.substr(4));
+        continue;
+      }
+
+      if (io_sets_.empty()) {
+        io_sets_.emplace_back();
+        io_sets_.back().set_name("default");
+      }
+
+      IoBinding b;
+      if (!b.parse(line))
+        return false;
+      io_sets_.back().mutable_bindings()->push_back(b);
+    }
+    if (io_sets_.empty())
+      return false;
+    selected_set_ = io_sets_.front();
+    return true;
+  }
+
+  // The selected set is written first so that it is selected again when
+  // the descriptor is parsed back.
+  std::string serialize() const {
+    std::ostringstream os;
+    selected_set_.serialize(os);
+    for (const IoSet &s : io_sets_)
+      if (s.name() != selected_set_.name())
+        s.serialize(os);
+    return os.str();
+  }
+
+  size_t ByteSizeLong() const { return serialize().size(); }
+
+  bool SerializeToArray(void *data, int size) const {
+    std::string s = serialize();
+    if (s.size() > (size_t)size)
+      return false;
+    s.copy(static_cast<char *>(data), s.size());
+    return true;
+  }
+
+private:
+  IoSet selected_set_;
+  std::vector<IoSet> io_sets_;
+};
+
+} // namespace aicapi
+
+#endif // QAIC_STUB_API_PB_H_
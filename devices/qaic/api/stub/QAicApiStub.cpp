@@ -0,0 +1,514 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Stand-in for the QAIC runtime library, for running and profiling the host
+// side of KILT (QAicInfApi, ActivationSet, Device) without cards.
+//
+// The program loaded from <model root>/programqpc.bin is a text description
+// of its buffers rather than a compiled QPC, e.g. for ResNet50 at batch 8:
+//
+//   input in UINT8 8,224,224,4
+//   ArgMax out INT64 8,1
+//
+// (see QAicApi.pb.h for the full format). Each queue has a device thread
+// that runs the enqueued executions one at a time, and a pool of callback
+// threads (numThreadsPerQueue of the queue, like the real driver) that
+// complete their events. Execution time is set from the environment:
+//
+//   QAIC_STUB_LATENCY_US           fixed time per execution (default 1000)
+//   QAIC_STUB_LATENCY_PER_ITEM_US  extra time per item in the batch, the
+//                                  first dimension of the first input
+//   QAIC_STUB_JITTER_US            uniform random extra time, up to this
+//   QAIC_STUB_CALLBACK_THREADS     callback threads per queue, overrides
+//                                  numThreadsPerQueue
+//   QAIC_STUB_TOUCH_BUFFERS        read the inputs and clear the outputs of
+//                                  every execution, as the DMA would
+//                                  (default 1)
+
+#include "QAicApi.h"
+#include "QAicApi.pb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+int envInt(const char *name, int default_value) {
+  const char *value = getenv(name);
+  return value ? atoi(value) : default_value;
+}
+
+struct StubSettings {
+  int latency_us = envInt("QAIC_STUB_LATENCY_US", 1000);
+  int latency_per_item_us = envInt("QAIC_STUB_LATENCY_PER_ITEM_US", 0);
+  int jitter_us = envInt("QAIC_STUB_JITTER_US", 0);
+  int callback_threads = envInt("QAIC_STUB_CALLBACK_THREADS", 0);
+  bool touch_buffers = envInt("QAIC_STUB_TOUCH_BUFFERS", 1) != 0;
+};
+
+const StubSettings &settings() {
+  static StubSettings s;
+  return s;
+}
+
+} // namespace
+
+struct QAicContext {
+  QID dev;
+};
+
+struct QAicQpcObj {
+  aicapi::IoDesc io;
+};
+
+struct QAicProgram {
+  aicapi::IoDesc io;
+  std::string desc; // serialised io, handed out as the IO descriptor
+};
+
+struct QAicExecObj {
+  aicapi::IoSet io;
+  std::vector<QBuffer> buffers;
+  // items in the batch, taken from the dimensions last set
+  uint32_t items = 1;
+  // zero copy buffers owned by the exec object
+  std::vector<std::unique_ptr<uint8_t[]>> storage;
+};
+
+struct QAicEvent {
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool complete = true;
+  std::vector<std::pair<QAicEventCallback, void *>> callbacks;
+};
+
+struct QAicQueue {
+  std::mutex mtx;
+  std::condition_variable cv_pending;
+  std::condition_variable cv_completed;
+
+  // waiting for the device thread
+  std::deque<std::pair<QAicExecObj *, QAicEvent *>> pending;
+  // done, waiting for a callback thread
+  std::deque<QAicEvent *> completed;
+
+  bool terminate_device = false;
+  bool terminate_callbacks = false;
+
+  std::thread device;
+  std::vector<std::thread> callback_threads;
+
+  int64_t executions = 0;
+  int64_t service_time = 0;
+};
+
+namespace {
+
+uint32_t itemsOf(const aicapi::IoSet &io, const QBufferDimensions *dims) {
+  for (size_t i = 0; i < io.bindings().size(); ++i) {
+    if (io.bindings(i).dir() != aicapi::BUFFER_IO_TYPE_INPUT)
+      continue;
+    if (dims != nullptr && dims[i].count > 0)
+      return dims[i].dims[0];
+    return io.bindings(i).dims().empty() ? 1 : io.bindings(i).dims()[0];
+  }
+  return 1;
+}
+
+// Read the inputs and clear the outputs, standing in for the DMA traffic.
+void touchBuffers(QAicExecObj *e) {
+  [[maybe_unused]] static volatile uint8_t sink;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < e->buffers.size(); ++i) {
+    QBuffer &b = e->buffers[i];
+    if (b.buf == nullptr || b.size == 0)
+      continue;
+    if (e->io.bindings(i).dir() == aicapi::BUFFER_IO_TYPE_INPUT) {
+      for (size_t x = 0; x < b.size; x += 64)
+        sum += b.buf[x];
+    } else {
+      memset(b.buf, 0, b.size);
+    }
+  }
+  sink = sum;
+}
+
+void completeEvent(QAicEvent *event) {
+  std::vector<std::pair<QAicEventCallback, void *>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(event->mtx);
+    event->complete = true;
+    callbacks = event->callbacks;
+  }
+  event->cv.notify_all();
+
+  // the callback may clear and re-enqueue the event straight away, so it
+  // is called on a copy with the event unlocked
+  for (auto &c : callbacks)
+    c.first(event, QAIC_EVENT_DEVICE_COMPLETE, c.second);
+}
+
+void deviceThread(QAicQueue *q) {
+  const StubSettings &s = settings();
+  std::minstd_rand rng(std::random_device{}());
+  std::uniform_int_distribution<int> jitter(0, std::max(s.jitter_us, 0));
+
+  while (true) {
+    std::pair<QAicExecObj *, QAicEvent *> job;
+    {
+      std::unique_lock<std::mutex> lock(q->mtx);
+      q->cv_pending.wait(
+          lock, [q] { return !q->pending.empty() || q->terminate_device; });
+      if (q->pending.empty())
+        break;
+      job = q->pending.front();
+      q->pending.pop_front();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int64_t us = s.latency_us + (int64_t)s.latency_per_item_us * job.first->items;
+    if (s.jitter_us > 0)
+      us += jitter(rng);
+
+    if (s.touch_buffers)
+      touchBuffers(job.first);
+
+    std::this_thread::sleep_until(start + std::chrono::microseconds(us));
+
+    {
+      std::lock_guard<std::mutex> lock(q->mtx);
+      ++q->executions;
+      q->service_time += std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+      q->completed.push_back(job.second);
+    }
+    q->cv_completed.notify_one();
+  }
+}
+
+void callbackThread(QAicQueue *q) {
+  while (true) {
+    QAicEvent *event;
+    {
+      std::unique_lock<std::mutex> lock(q->mtx);
+      q->cv_completed.wait(lock, [q] {
+        return !q->completed.empty() || q->terminate_callbacks;
+      });
+      if (q->completed.empty())
+        break;
+      event = q->completed.front();
+      q->completed.pop_front();
+    }
+    completeEvent(event);
+  }
+}
+
+QStatus execObjGetIoBuffers(const QAicExecObj *execObj, uint32_t *numBuffers,
+                            QBuffer **buffers) {
+  if (execObj == nullptr || numBuffers == nullptr || buffers == nullptr)
+    return QS_INVAL;
+  *numBuffers = execObj->buffers.size();
+  *buffers = const_cast<QBuffer *>(execObj->buffers.data());
+  return QS_SUCCESS;
+}
+
+} // namespace
+
+extern "C" {
+
+const QAicApiFunctionTable *qaicGetFunctionTable() {
+  static const QAicApiFunctionTable table = {execObjGetIoBuffers};
+  return &table;
+}
+
+QStatus qaicGetDeviceInfo(QID dev, QDevInfo *info) {
+  if (info == nullptr)
+    return QS_INVAL;
+  info->devStatus = QDS_READY;
+  return QS_SUCCESS;
+}
+
+QStatus qaicGetAicVersion(uint16_t *major, uint16_t *minor, const char **patch,
+                          const char **variant) {
+  *major = LRT_LIB_MAJOR_VERSION;
+  *minor = LRT_LIB_MINOR_VERSION;
+  *patch = "0";
+  *variant = "stub";
+  return QS_SUCCESS;
+}
+
+QStatus qaicCreateContext(QAicContext **context,
+                          QAicContextProperties_t *properties,
+                          uint32_t numDevices, QID *devices,
+                          QAicLogCallback logCallback, void *logUserData,
+                          QAicErrorHandler errorHandler, void *errUserData) {
+  if (context == nullptr || numDevices < 1 || devices == nullptr)
+    return QS_INVAL;
+  *context = new QAicContext{devices[0]};
+  return QS_SUCCESS;
+}
+
+QStatus qaicReleaseContext(QAicContext *context) {
+  delete context;
+  return QS_SUCCESS;
+}
+
+QStatus qaicProgramPropertiesInitDefault(QAicProgramProperties_t *properties) {
+  if (properties == nullptr)
+    return QS_INVAL;
+  properties->SubmitRetryTimeoutMs = 0;
+  return QS_SUCCESS;
+}
+
+QStatus qaicOpenQpc(QAicQpcObj **qpc, const uint8_t *buf, size_t size,
+                    bool copy) {
+  if (qpc == nullptr || buf == nullptr)
+    return QS_INVAL;
+  QAicQpcObj *q = new QAicQpcObj;
+  if (!q->io.ParseFromArray(buf, size)) {
+    std::cerr << "QAIC stub: program is not a stub buffer description"
+              << std::endl;
+    delete q;
+    return QS_ERROR;
+  }
+  *qpc = q;
+  return QS_SUCCESS;
+}
+
+QStatus qaicCloseQpc(QAicQpcObj *qpc) {
+  delete qpc;
+  return QS_SUCCESS;
+}
+
+QStatus qaicCreateProgram(QAicContext *context, QAicProgram **program,
+                          QAicProgramProperties_t *properties, QID dev,
+                          const char *name, QAicQpcObj *qpc) {
+  if (program == nullptr || qpc == nullptr)
+    return QS_INVAL;
+  QAicProgram *p = new QAicProgram;
+  p->io = qpc->io;
+  p->desc = p->io.serialize();
+  *program = p;
+  return QS_SUCCESS;
+}
+
+QStatus qaicReleaseProgram(QAicProgram *program) {
+  delete program;
+  return QS_SUCCESS;
+}
+
+QStatus qaicLoadProgram(QAicProgram *program) {
+  return program ? QS_SUCCESS : QS_INVAL;
+}
+
+QStatus qaicUnloadProgram(QAicProgram *program) {
+  return program ? QS_SUCCESS : QS_INVAL;
+}
+
+QStatus qaicRunActivationCmd(QAicProgram *program,
+                             QAicProgramActivationCmd cmd) {
+  return program ? QS_SUCCESS : QS_INVAL;
+}
+
+QStatus qaicProgramGetIoDescriptor(const QAicProgram *program, QData *ioDesc) {
+  if (program == nullptr || ioDesc == nullptr)
+    return QS_INVAL;
+  ioDesc->data = (uint8_t *)program->desc.data();
+  ioDesc->size = program->desc.size();
+  return QS_SUCCESS;
+}
+
+QStatus qaicReleaseConstants(QAicConstants *constants) { return QS_SUCCESS; }
+
+QStatus qaicCreateQueue(QAicContext *context, QAicQueue **queue,
+                        QAicQueueProperties *properties, QID dev) {
+  if (queue == nullptr)
+    return QS_INVAL;
+
+  int threads = settings().callback_threads;
+  if (threads < 1)
+    threads = properties ? properties->numThreadsPerQueue : 1;
+  threads = std::max(threads, 1);
+
+  QAicQueue *q = new QAicQueue;
+  q->device = std::thread(deviceThread, q);
+  for (int i = 0; i < threads; ++i)
+    q->callback_threads.push_back(std::thread(callbackThread, q));
+  *queue = q;
+  return QS_SUCCESS;
+}
+
+// Finishes everything already enqueued before returning.
+QStatus qaicReleaseQueue(QAicQueue *queue) {
+  if (queue == nullptr)
+    return QS_INVAL;
+
+  {
+    std::lock_guard<std::mutex> lock(queue->mtx);
+    queue->terminate_device = true;
+  }
+  queue->cv_pending.notify_all();
+  queue->device.join();
+
+  {
+    std::lock_guard<std::mutex> lock(queue->mtx);
+    queue->terminate_callbacks = true;
+  }
+  queue->cv_completed.notify_all();
+  for (auto &t : queue->callback_threads)
+    t.join();
+
+  if (queue->executions > 0)
+    std::cout << "QAIC stub queue: " << queue->executions
+              << " executions, mean " << queue->service_time / queue->executions
+              << "us" << std::endl;
+
+  delete queue;
+  return QS_SUCCESS;
+}
+
+QStatus qaicCreateExecObj(QAicContext *context, QAicExecObj **execObj,
+                          const QAicExecObjProperties_t *properties,
+                          const QAicProgram *program, const QData *ioDesc,
+                          const QData *reserved0, const QData *reserved1) {
+  if (execObj == nullptr || program == nullptr)
+    return QS_INVAL;
+
+  QAicExecObj *e = new QAicExecObj;
+  if (ioDesc != nullptr && ioDesc->data != nullptr) {
+    aicapi::IoDesc io;
+    if (!io.ParseFromArray(ioDesc->data, ioDesc->size)) {
+      delete e;
+      return QS_INVAL;
+    }
+    e->io = io.selected_set();
+  } else {
+    e->io = program->io.selected_set();
+  }
+
+  e->buffers.resize(e->io.bindings().size(), QBuffer{0, nullptr});
+  e->items = itemsOf(e->io, nullptr);
+
+  if (properties && (*properties & QAIC_EXECOBJ_PROPERTIES_ZERO_COPY_BUFFERS)) {
+    for (size_t i = 0; i < e->buffers.size(); ++i) {
+      size_t size = e->io.bindings(i).size();
+      e->storage.emplace_back(new uint8_t[size]());
+      e->buffers[i] = QBuffer{size, e->storage.back().get()};
+    }
+  }
+
+  *execObj = e;
+  return QS_SUCCESS;
+}
+
+QStatus qaicReleaseExecObj(QAicExecObj *execObj) {
+  delete execObj;
+  return QS_SUCCESS;
+}
+
+QStatus qaicExecObjSetDataExt(QAicExecObj *execObj, uint32_t numBuffers,
+                              const QBuffer *buffers,
+                              const QBufferDimensions *dims) {
+  if (execObj == nullptr || buffers == nullptr ||
+      numBuffers != execObj->buffers.size())
+    return QS_INVAL;
+  std::copy(buffers, buffers + numBuffers, execObj->buffers.begin());
+  execObj->items = itemsOf(execObj->io, dims);
+  return QS_SUCCESS;
+}
+
+QStatus qaicCreateEvent(QAicContext *context, QAicEvent **event,
+                        QAicEventCompletionType type) {
+  if (event == nullptr)
+    return QS_INVAL;
+  *event = new QAicEvent;
+  return QS_SUCCESS;
+}
+
+QStatus qaicReleaseEvent(QAicEvent *event) {
+  delete event;
+  return QS_SUCCESS;
+}
+
+QStatus qaicEventClear(QAicEvent *event) {
+  if (event == nullptr)
+    return QS_INVAL;
+  std::lock_guard<std::mutex> lock(event->mtx);
+  event->complete = false;
+  return QS_SUCCESS;
+}
+
+QStatus qaicEventAddCallback(QAicEvent *event, QAicEventCallback callback,
+                             void *userData) {
+  if (event == nullptr || callback == nullptr)
+    return QS_INVAL;
+  std::lock_guard<std::mutex> lock(event->mtx);
+  event->callbacks.push_back({callback, userData});
+  return QS_SUCCESS;
+}
+
+QStatus qaicEventRemoveCallback(QAicEvent *event, QAicEventCallback callback) {
+  if (event == nullptr)
+    return QS_INVAL;
+  std::lock_guard<std::mutex> lock(event->mtx);
+  auto &c = event->callbacks;
+  c.erase(std::remove_if(c.begin(), c.end(),
+                         [callback](const std::pair<QAicEventCallback, void *>
+                                        &e) { return e.first == callback; }),
+          c.end());
+  return QS_SUCCESS;
+}
+
+QStatus qaicWaitforEvent(QAicEvent *event) {
+  if (event == nullptr)
+    return QS_INVAL;
+  std::unique_lock<std::mutex> lock(event->mtx);
+  event->cv.wait(lock, [event] { return event->complete; });
+  return QS_SUCCESS;
+}
+
+QStatus qaicEnqueueExecObj(QAicQueue *queue, QAicExecObj *execObj,
+                           QAicEvent *event) {
+  if (queue == nullptr || execObj == nullptr || event == nullptr)
+    return QS_INVAL;
+  {
+    std::lock_guard<std::mutex> lock(queue->mtx);
+    queue->pending.emplace_back(execObj, event);
+  }
+  queue->cv_pending.notify_one();
+  return QS_SUCCESS;
+}
+}
@@ -51,19 +51,46 @@ public:
     return qaic_threads_per_queue;
   }
   virtual const int getInputSelect() const { return qaic_input_select; }
+  // Alignment data source memory needs for inputs to be bound to it.
+  virtual const int getInputAlignment() const { return qaic_input_alignment; }
   virtual const std::string getSkipStage() const { return qaic_skip_stage; }
   virtual const std::string getModelRoot() const { return qaic_model_root; }
+  // Map programqpc.bin from the page cache instead of reading it, and
+  // whether to fault it all in when mapped.
+  virtual const bool getProgramMap() const { return qaic_program_map; }
+  virtual const bool getProgramPopulate() const {
+    return qaic_program_populate;
+  }
+  // Allocate the IO buffers from one NUMA-placed arena per device, on 2MB
+  // pages if available, each aligned to getBufferAlignment() bytes.
+  virtual const bool getBufferArena() const { return qaic_buffer_arena; }
+  virtual const bool getBufferHugepages() const {
+    return qaic_buffer_hugepages;
+  }
+  virtual const int getBufferAlignment() const {
+    return qaic_buffer_alignment;
+  }
   virtual const bool ringfenceDeviceDriver() const {
     return qaic_ringfence_driver;
   }
 
   virtual const int getSamplesQueueDepth() const { return samples_queue_depth; }
 
+  // Threads staging and issuing payloads; 0 does it on the scheduler.
+  virtual const int getEnqueueThreadCount() const { return enqueue_threads; }
+
   virtual const int getSchedulerYieldTime() { return scheduler_yield_time; }
+  // Microseconds an idle scheduler (or enqueue thread) spins before sleeping
+  // until the next batch arrives; negative keeps polling with the yield
+  // times instead.
+  virtual const int getSchedulerSpinTime() { return scheduler_spin_time; }
   virtual const int getEnqueueYieldTime() { return enqueue_yield_time; }
 
   virtual const bool getLoopback() const { return qaic_loopback; }
 
+  // Resize ONE_SHOT buffers to partial batches when the model allows it.
+  virtual const bool getDynamicBatch() const { return qaic_dynamic_batch; }
+
   virtual const ExecutionMode getExecutionMode() {
     return qaic_execution_mode;
   };
@@ -83,9 +110,27 @@ private:
   std::string qaic_skip_stage =
       alter_str(getconfig_c("KILT_DEVICE_QAIC_SKIP_STAGE"), std::string(""));
 
+  const bool qaic_program_map =
+      getconfig_opt_b(std::string("KILT_DEVICE_QAIC_PROGRAM_MMAP"), true);
+
+  const bool qaic_program_populate =
+      getconfig_opt_b(std::string("KILT_DEVICE_QAIC_PROGRAM_POPULATE"), true);
+
+  const bool qaic_buffer_arena =
+      getconfig_opt_b(std::string("KILT_DEVICE_QAIC_BUFFER_ARENA"), true);
+
+  const bool qaic_buffer_hugepages =
+      getconfig_opt_b(std::string("KILT_DEVICE_QAIC_BUFFER_HUGEPAGES"), true);
+
+  const int qaic_buffer_alignment =
+      alter_str_i(getconfig_c("KILT_DEVICE_QAIC_BUFFER_ALIGNMENT"), 4096);
+
   const int qaic_input_select =
       alter_str_i(getconfig_c("KILT_DEVICE_QAIC_INPUT_SELECT"), 0);
 
+  const int qaic_input_alignment =
+      alter_str_i(getconfig_c("KILT_DEVICE_QAIC_INPUT_ALIGNMENT"), 64);
+
   const int samples_queue_depth =
       alter_str_i(getconfig_c("KILT_DEVICE_QAIC_SAMPLES_QUEUE_DEPTH"), 8);
 
@@ -95,12 +140,21 @@ private:
   const int scheduler_yield_time =
       alter_str_i(getconfig_c("KILT_DEVICE_QAIC_SCHEDULER_YIELD_TIME"), -1);
 
+  const int enqueue_threads =
+      alter_str_i(getconfig_c("KILT_DEVICE_QAIC_ENQUEUE_THREADS"), 0);
+
   const int enqueue_yield_time =
       alter_str_i(getconfig_c("KILT_DEVICE_QAIC_ENQUEUE_YIELD_TIME"), -1);
 
+  const int scheduler_spin_time =
+      alter_str_i(getconfig_c("KILT_DEVICE_QAIC_SCHEDULER_SPIN_TIME"), -1);
+
   const bool qaic_loopback =
       getconfig_opt_b(std::string("KILT_DEVICE_QAIC_LOOPBACK"), false);
 
+  const bool qaic_dynamic_batch =
+      getconfig_opt_b(std::string("KILT_DEVICE_QAIC_DYNAMIC_BATCH"), true);
+
   ExecutionMode qaic_execution_mode;
 };
 
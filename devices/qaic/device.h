@@ -25,17 +25,18 @@
 #ifndef DEVICE_H
 #define DEVICE_H
 
+#include <condition_variable>
 #include <queue>
 
 #include "api/master/QAicInfApi.h"
 #include "config/device_config.h"
+#include "device_telemetry.h"
+#include "payload_pool.h"
+#include "spsc_ring.h"
 #include "idatasource.h"
 #include "imodel.h"
 
 //#define NO_QAIC
-//#define ENQUEUE_SHIM_THREADED
-//#define ENQUEUE_SHIM_THREADED_COUNT 2
-#define ENQUEUE_SHIM_THREADED_COUNT 0
 
 using namespace KRAI;
 using namespace qaic_api;
@@ -43,78 +44,72 @@ using namespace qaic_api;
 template <typename Sample> class Device;
 
 template <typename Sample> struct Payload {
-  std::vector<Sample> samples;
+  Batch<Sample> *batch;
+  std::chrono::time_point<std::chrono::steady_clock> enqueued;
+  int64_t acquired; // telemetry time the set was taken
   int device;
   int activation;
   int set;
   Device<Sample> *dptr;
 };
 
+// Free payloads (one per set) of an activation. getPayload() is called by
+// the scheduler and release() by the completion threads, neither locks.
 template <typename Sample> class RingBuffer {
 
 public:
-  RingBuffer(int d, int a, int s) {
-    size = s;
-    for (int i = 0; i < s; ++i) {
-      auto p = new Payload<Sample>;
-      p->set = i;
-      p->activation = a;
-      p->device = d;
-      q.push(p);
-    }
-  }
-
-  RingBuffer(int d, int a, int s, Device<Sample> *dptr) {
-    size = s;
+  RingBuffer(int d, int a, int s, Device<Sample> *dptr,
+             ActivationMask *_mask = nullptr)
+      : free_sets(s) {
+    activation = a;
+    mask = _mask;
     for (int i = 0; i < s; ++i) {
       auto p = new Payload<Sample>;
       p->set = i;
       p->activation = a;
       p->device = d;
       p->dptr = dptr;
-      q.push(p);
+      payloads.push_back(p);
     }
+    for (int i = s - 1; i >= 0; --i)
+      release(payloads[i]);
   }
 
   virtual ~RingBuffer() {
-    while (!q.empty()) {
-      auto f = q.front();
-      q.pop();
-      delete f;
-    }
+    for (auto p : payloads)
+      delete p;
   }
 
   Payload<Sample> *getPayload() {
-    std::unique_lock<std::mutex> lock(mtx);
-    if (q.empty())
-      return nullptr;
-    else {
-      auto f = q.front();
-      q.pop();
-      return f;
+    int set = free_sets.pop();
+    if (set >= 0)
+      return payloads[set];
+
+    // out of payloads - drop out of the mask, then re-check in case a
+    // release() slipped in before the bit was cleared
+    if (mask) {
+      mask->clear(activation);
+      if (!free_sets.empty())
+        mask->set(activation);
     }
+    return nullptr;
   }
 
   void release(Payload<Sample> *p) {
-    std::unique_lock<std::mutex> lock(mtx);
-    // std::cout << "Release before: " << front << " end: " << end << std::endl;
-    if (q.size() == size || p == nullptr) {
+    if (p == nullptr) {
       std::cerr << "extra elem in the queue" << std::endl;
-      // assert(1);
+      return;
     }
-    q.push(p);
-    // std::cout << "Release after: " << front << " end: " << end << std::endl;
-  }
-
-  void debug() {
-    // std::cout << "QUEUE front: " << front << " end: " << end << std::endl;
+    free_sets.push(p->set);
+    if (mask)
+      mask->set(activation);
   }
 
 private:
-  std::queue<Payload<Sample> *> q;
-  int size;
-  bool isEmpty;
-  std::mutex mtx;
+  std::vector<Payload<Sample> *> payloads;
+  IndexStack free_sets;
+  int activation;
+  ActivationMask *mask;
 };
 
 typedef void (*DeviceExec)(void *data);
@@ -126,12 +121,15 @@ public:
 
   typedef void (Device<Sample>::*executePtr)(Payload<Sample> *p);
 
-  Device() : state(State::WAITING), total_execution_time(0) {}
+  Device() : state(State::WAITING) {}
 
   void Construct(IModel *_model, IDataSource *_data_source, IConfig *_config,
                  int hw_id, std::vector<int> aff) {
 
+    auto t_start = std::chrono::steady_clock::now();
+
     device_id = hw_id;
+    device_affinity = aff;
 
     QAicDeviceConfig *device_cfg =
         static_cast<QAicDeviceConfig *>(_config->device_cfg);
@@ -181,20 +179,30 @@ public:
 
     tin.join();
 
-    state = State::READY;
+    PrintStartup(t_start);
+
+    std::lock_guard<std::mutex> lock(mtx_ready);
+    if (state != State::ERROR)
+      state = State::READY;
+    cv_ready.notify_all();
   }
 
-  virtual int Inference(std::vector<Sample> samples) {
+  virtual State WaitReady() {
+    std::unique_lock<std::mutex> lock(mtx_ready);
+    cv_ready.wait(lock, [this] { return state != State::WAITING; });
+    return state;
+  }
 
-    if (sback >= sfront + samples_queue_depth)
-      return -1;
+  virtual int Inference(Batch<Sample> *batch) {
 
-    samples_queue[sback % samples_queue_depth] = samples;
-    ++sback;
+    if (!samples_queue->push({batch, std::chrono::steady_clock::now()}))
+      return -1;
 
-    return samples_queue_depth - (sback - sfront);
+    return samples_queue->getFreeSlots();
   }
 
+  virtual int GetFreeSlots() { return samples_queue->getFreeSlots(); }
+
   // ---------- PIPELINE METHODS ----------
   void RunDevice(void* metadata) {
     Payload<Sample> *p = reinterpret_cast<Payload<Sample>*>(metadata);
@@ -221,34 +229,64 @@ public:
     return runner->getBufferDimsFromId(id);
   }
 
+  virtual const DeviceTelemetry *GetTelemetry() const { return telemetry; }
+
   //TODO: do we need this or done at the end of the call to pipeline?
   void ReleaseInstance(void* metadata) {
     Payload<Sample> *p = reinterpret_cast<Payload<Sample>*>(metadata);
-    p->dptr->ring_buf[p->activation]->release(p);
+    p->dptr->ReleasePayload(p);
   }
   // --------------------------------------
 
   ~Device() {
     scheduler_terminate = true;
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (samples_queue)
+      samples_queue->wake();
     scheduler.join();
 
-#ifdef ENQUEUE_SHIM_THREADED
-    shim_terminate = true;
-    for (int i = 0; i < num_setup_threads; ++i)
-      payload_threads[i].join();
+    // the hardware may still be working on payloads issued before the
+    // scheduler stopped - wait for them before tearing the runner down
+    {
+      std::unique_lock<std::mutex> lock(mtx_idle);
+      if (!cv_idle.wait_for(lock, std::chrono::milliseconds(drain_timeout),
+                            [this] { return payloads_in_flight == 0; }))
+        std::cout << "Device " << device_id << ": " << payloads_in_flight
+                  << " payloads still in flight at shutdown" << std::endl;
+    }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-#endif
+    // the enqueue workers have staged everything the scheduler gave them
+    enqueue_terminate = true;
+    for (int i = 0; i < enqueue_threads.size(); ++i) {
+      enqueue_queues[i]->wake();
+      enqueue_threads[i].join();
+      delete enqueue_queues[i];
+    }
+
+    delete samples_queue;
+    delete free_activations;
+
+    if (bound_batches + copied_batches > 0)
+      std::cout << "Direct input binding on device " << device_id << ": "
+                << bound_batches << " batches bound, " << copied_batches
+                << " copied, " << bytes_not_copied / (1024 * 1024)
+                << "MB not copied, " << bytes_copied / (1024 * 1024)
+                << "MB copied" << std::endl;
+
+    if (dynamic_batch)
+      std::cout << "Dynamic batch on device " << device_id << ": "
+                << reshaped_sets << " buffer reshapes" << std::endl;
+    else if (padded_batches > 0)
+      std::cout << "Padding on device " << device_id << ": "
+                << padded_batches << " partial batches run at full size"
+                << std::endl;
+
+    if (telemetry)
+      telemetry->print(std::cout, device_id);
+    delete telemetry;
 
 #ifndef NO_QAIC
     runner->deinit();
     delete runner;
-    if(total_execution_time > 0 ) {
-      std::cout << "Execution time on device " <<
-	device_id << ": " << total_execution_time/1000 <<
-	"s" << std::endl;
-    }
 #endif
   }
 
@@ -268,10 +306,13 @@ private:
     samples_queue_depth = device_cfg->getSamplesQueueDepth();
 
     scheduler_yield_time = device_cfg->getSchedulerYieldTime();
+    scheduler_spin_time = device_cfg->getSchedulerSpinTime();
     enqueue_yield_time = device_cfg->getEnqueueYieldTime();
 
     loop_back = device_cfg->getLoopback();
 
+    drain_timeout = _config->server_cfg->getDrainTimeout();
+
 #ifndef NO_QAIC
 
     std::cout << "Creating device " << hw_id << std::endl;
@@ -282,6 +323,13 @@ private:
     runner->setSetSize(device_cfg->getSetSize());
     runner->setNumThreadsPerQueue(device_cfg->getNumThreadsPerQueue());
     runner->setSkipStage(device_cfg->getSkipStage());
+    runner->setProgramMapping(device_cfg->getProgramMap(),
+                              device_cfg->getProgramPopulate());
+    // buffers go on the node of the device's host cores
+    runner->setBufferArena(
+        device_cfg->getBufferArena(), device_cfg->getBufferHugepages(),
+        device_cfg->getBufferAlignment(),
+        device_affinity.empty() ? -1 : device_affinity.front());
 
     QStatus status;
     if(device_cfg->getExecutionMode() == ONE_SHOT)
@@ -295,6 +343,7 @@ private:
     }
 
     buffers_in.resize(activation_count);
+    inputs_bound.resize(activation_count);
     buffers_out.resize(activation_count);
     buffers_all.resize(activation_count);
 
@@ -306,11 +355,13 @@ private:
     // get references to all the buffers
     for (int a = 0; a < activation_count; ++a) {
       buffers_in[a].resize(device_cfg->getSetSize());
+      inputs_bound[a].resize(device_cfg->getSetSize());
       buffers_out[a].resize(device_cfg->getSetSize());
       buffers_all[a].resize(device_cfg->getSetSize());
       for (int s = 0; s < device_cfg->getSetSize(); ++s) {
         for (int i = 0; i < model_cfg->getInputCount(); ++i) {
           buffers_in[a][s].push_back((void *)runner->getBufferPtr(a, s, i));
+          inputs_bound[a][s].push_back(buffers_in[a][s].back());
           buffers_all[a][s].push_back((void *)runner->getBufferPtr(a, s, i));
         }
         for (int o = 0; o < model_cfg->getOutputCount(); ++o) {
@@ -322,20 +373,29 @@ private:
       }
     }
 
+    // buffers start out shaped for a full batch
+    dynamic_batch = device_cfg->getDynamicBatch() && model_cfg->hasDynamicBatch();
+    batch_applied.assign(activation_count,
+                         std::vector<int>(device_cfg->getSetSize(),
+                                          model_cfg->getBatchSize()));
+
 #else
     std::cout << "Creating dummy device " << hw_id << std::endl;
 #endif
 
+    telemetry = new DeviceTelemetry(activation_count, device_cfg->getSetSize());
+
     // create enough ring buffers for each activation
     ring_buf.resize(activation_count);
 
+    free_activations = new ActivationMask(activation_count);
+
     // populate ring buffer
     for (int a = 0; a < activation_count; ++a)
-      ring_buf[a] =
-          new RingBuffer<Sample>(0, a, device_cfg->getSetSize(), this);
+      ring_buf[a] = new RingBuffer<Sample>(0, a, device_cfg->getSetSize(),
+                                           this, free_activations);
 
-    samples_queue.resize(samples_queue_depth);
-    sfront = sback = 0;
+    samples_queue = new SPSCRing<QueuedBatch<Sample>>(samples_queue_depth);
 
     // Kick off the scheduler
     scheduler = std::thread(&Device::QueueScheduler, this);
@@ -354,19 +414,25 @@ private:
 
     aff->pop_back();
 
-#ifdef ENQUEUE_SHIM_THREADED
-    shim_terminate = false;
+    // Enqueue workers stage (configureWorkload) and issue payloads so that
+    // several batches can be copied into different activation/set buffers
+    // at once. Each has its own queue, sized to hold every payload of the
+    // device so the scheduler never blocks on it. With no workers the
+    // scheduler enqueues inline.
+    enqueue_terminate = false;
+
+    int payload_count = activation_count * device_cfg->getSetSize();
 
-    num_setup_threads = ENQUEUE_SHIM_THREADED_COUNT;
+    for (int i = 0; i < device_cfg->getEnqueueThreadCount(); ++i) {
 
-    payloads.resize(num_setup_threads, nullptr);
+      enqueue_queues.push_back(new SPSCRing<Payload<Sample> *>(payload_count));
+      enqueue_threads.push_back(std::thread(&Device::EnqueueWorker, this, i));
 
-    for (int i = 0; i < num_setup_threads; ++i) {
+      if (aff->empty())
+        continue;
 
-      std::cout << "Shim thread " << aff->back() << std::endl;
-      payload_threads.push_back(std::thread(&Device::EnqueueShim, this, i));
+      std::cout << "Enqueue thread " << aff->back() << std::endl;
 
-      // set the affinity of the shim
       cpu_set_t cpu_set;
       CPU_ZERO(&cpu_set);
 
@@ -374,35 +440,35 @@ private:
 
       CPU_SET(cpu, &cpu_set);
 
-      pthread_setaffinity_np(payload_threads.back().native_handle(),
+      pthread_setaffinity_np(enqueue_threads.back().native_handle(),
                              sizeof(cpu_set_t), &cpu_set);
 
-      aff->pop_back();
+      // share the last core rather than leave a worker unpinned
+      if (aff->size() > 1)
+        aff->pop_back();
     }
-
-#else
-    payloads.resize(1, nullptr);
-    shim_terminate = true;
-#endif
   }
 
   void OneShot(Payload<Sample> *p) {
 
+    auto t_stage = std::chrono::steady_clock::now();
+
 #ifndef NO_QAIC
+    ResizeBatch(p);
+
     // set the data
     if (device_cfg->getInputSelect() == 0) {
-      model->configureWorkload(data_source, this, &(p->samples),
+      model->configureWorkload(data_source, this, &(p->batch->samples),
                                 buffers_in[p->activation][p->set]);
     } else if (device_cfg->getInputSelect() == 1) {
-      assert(false);
-      // TODO: We no longer support this as we're copying directly into the
-      // buffer?
-      // void *samples_ptr = session->getSamplePtr(p->samples[0].index);
-      // runner->setBufferPtr(p->activation, p->set, 0, samples_ptr);
+      BindInputs(p);
     } else {
       // Do nothing - random data
     }
 
+    CountStaging(p, t_stage);
+    telemetry->issued(p->activation);
+
     if (loop_back) {
       PostResultsCallback(NULL, QAIC_EVENT_DEVICE_COMPLETE, p);
     } else {
@@ -412,41 +478,144 @@ private:
         throw "Failed to invoke qaic";
     }
 #else
+    CountStaging(p, t_stage);
+    telemetry->issued(p->activation);
     PostResultsCallback(NULL, QAIC_EVENT_DEVICE_COMPLETE, p);
 #endif
 
   }
 
+  // Shape the set's buffers to the number of samples actually in the batch
+  // when the model has a dynamic batch dimension, so a partial batch is not
+  // padded out to the full one. The shape last applied to each set is cached
+  // as runs of the same size are the common case.
+  void ResizeBatch(Payload<Sample> *p) {
+    int n = p->batch->samples.size();
+    int full = model_cfg->getBatchSize();
+
+    if (!dynamic_batch) {
+      if (n < full)
+        ++padded_batches;
+      return;
+    }
+
+    int &applied = batch_applied[p->activation][p->set];
+    if (applied == n)
+      return;
+
+    int inputs = model_cfg->getInputCount();
+    for (int i = 0; i < inputs; ++i) {
+      std::vector<int> dims = model_cfg->getInputDimensions(i);
+      dims[0] = n;
+      if (runner->reshapeBuffer(p->activation, p->set, i, dims) != QS_SUCCESS)
+        throw "Failed to reshape input buffer";
+    }
+    for (int o = 0; o < model_cfg->getOutputCount(); ++o) {
+      std::vector<int> dims = model_cfg->getOutputDimensions(o);
+      dims[0] = n;
+      if (runner->reshapeBuffer(p->activation, p->set, o + inputs, dims) !=
+          QS_SUCCESS)
+        throw "Failed to reshape output buffer";
+    }
+
+    applied = n;
+    ++reshaped_sets;
+  }
+
+  // Point the set's inputs straight at the batch where the model reports it
+  // is already contiguous (and suitably aligned) in memory, otherwise back at
+  // the set's own buffer and stage it with configureWorkload() as usual.
+  void BindInputs(Payload<Sample> *p) {
+    std::vector<void *> &bound = inputs_bound[p->activation][p->set];
+    bool copy = false;
+    int64_t bytes = 0;
+
+    for (int i = 0; i < model_cfg->getInputCount(); ++i) {
+      void *ptr =
+          model->getContiguousInput(data_source, &(p->batch->samples), i);
+
+      if (ptr != nullptr &&
+          reinterpret_cast<uintptr_t>(ptr) % device_cfg->getInputAlignment())
+        ptr = nullptr;
+
+      // the input buffer is sized for a full batch, count the samples in
+      // this one only
+      bytes += model_cfg->getInputByteSize(i) / model_cfg->getBatchSize() *
+               p->batch->samples.size();
+
+      if (ptr == nullptr) {
+        ptr = buffers_in[p->activation][p->set][i];
+        copy = true;
+      }
+
+      if (bound[i] != ptr) {
+        QStatus status = runner->setBufferPtr(p->activation, p->set, i, ptr);
+        if (status != QS_SUCCESS)
+          throw "Failed to bind input buffer";
+        bound[i] = ptr;
+      }
+    }
+
+    // configureWorkload() stages every input, bound or not
+    if (copy) {
+      model->configureWorkload(data_source, this, &(p->batch->samples),
+                               buffers_in[p->activation][p->set]);
+      ++copied_batches;
+      bytes_copied += bytes;
+    } else {
+      ++bound_batches;
+      bytes_not_copied += bytes;
+    }
+  }
+
+  // Host staging time of the batch, kept per activation by the telemetry.
+  void CountStaging(Payload<Sample> *p,
+                    std::chrono::time_point<std::chrono::steady_clock> start) {
+    telemetry->staged(p->activation,
+                      std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+  }
+
   void Pipeline(Payload<Sample> *p) {
 
-    auto t_before = std::chrono::high_resolution_clock::now();
+    telemetry->issued(p->activation);
 
-    model->pipeline(this, data_source, &p->samples, buffers_all[p->activation][p->set], p);
+    model->pipeline(this, data_source, &p->batch->samples, buffers_all[p->activation][p->set], p);
 
-    auto t_after = std::chrono::high_resolution_clock::now();
-    total_execution_time += std::chrono::duration_cast<std::chrono::milliseconds>(t_after-t_before).count();
+    telemetry->completed(p->activation, p->batch->samples.size());
 
-    ring_buf[p->activation]->release(p);
+    this->BatchCompleted(
+        p->batch->samples.size(),
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - p->enqueued)
+            .count());
+
+    p->batch->release();
+    ReleasePayload(p);
   }
 
-  void EnqueueShim(int id) {
+  void EnqueueWorker(int id) {
 
-    do {
-      // std::cout << "Shim " << sched_getcpu() << std::endl;
-      if (payloads[id] != nullptr) {
-        Payload<Sample> *p = payloads[id];
+    SPSCRing<Payload<Sample> *> *queue = enqueue_queues[id];
+    Payload<Sample> *p;
 
+    while (true) {
+      if (queue->pop(p)) {
         // Run ONE_SHOT or PIPELINE.
         (this->*execute_ptr)(p);
-
-        payloads[id] = nullptr;
-      } else {
-        if (enqueue_yield_time)
-          std::this_thread::sleep_for(
-              std::chrono::microseconds(enqueue_yield_time));
+        continue;
       }
 
-    } while (!shim_terminate);
+      if (enqueue_terminate)
+        break;
+
+      if (scheduler_spin_time >= 0)
+        queue->wait(scheduler_wait_timeout, scheduler_spin_time);
+      else if (enqueue_yield_time)
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(enqueue_yield_time));
+    }
   }
 
   void QueueScheduler() {
@@ -454,61 +623,65 @@ private:
     // current activation index
     int activation = -1;
 
-    std::vector<Sample> qs(model_cfg->getBatchSize());
+    QueuedBatch<Sample> qs;
 
     while (!scheduler_terminate) { // loop forever waiting for input
       // std::cout << "Scheduler " << sched_getcpu() << std::endl;
-      if (sfront == sback) {
-        // No samples then post last results and continue
-        // Device::PostResults(nullptr, QAIC_EVENT_DEVICE_COMPLETE, this);
-        if (scheduler_yield_time)
+      if (!samples_queue->pop(qs)) {
+        // nothing queued - spin then sleep until Inference() wakes us, or
+        // poll as before when blocking is disabled
+        if (scheduler_spin_time >= 0)
+          samples_queue->wait(scheduler_wait_timeout, scheduler_spin_time);
+        else if (scheduler_yield_time)
           std::this_thread::sleep_for(
               std::chrono::microseconds(scheduler_yield_time));
-
         continue;
       }
 
-      // copy the image list and remove from queue
-      qs = samples_queue[sfront % samples_queue_depth];
-      ++sfront;
-
-      // if(config->getVerbosityServer())
-      //  std::cout << "<" << sback - sfront << ">";
+      int64_t t_dequeued = telemetry->now();
+      telemetry->dequeued(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - qs.enqueued)
+              .count());
 
       while (!scheduler_terminate) {
 
-        activation = (activation + 1) % activation_count;
+        // next activation, round robin, that has a free payload
+        int next = free_activations->next(activation);
 
-        Payload<Sample> *p = ring_buf[activation]->getPayload();
+        Payload<Sample> *p =
+            next < 0 ? nullptr : ring_buf[next]->getPayload();
 
-        // if no hardware slots available then increment the activation
-        // count and then continue
+        // if no hardware slots available anywhere then wait, otherwise we
+        // raced with another taker - just look again
         if (p == nullptr) {
-          if (scheduler_yield_time)
+          if (next < 0 && scheduler_yield_time)
             std::this_thread::sleep_for(
                 std::chrono::microseconds(scheduler_yield_time));
           continue;
         }
 
-        // add the image samples to the payload
-        p->samples = qs;
+        activation = next;
 
-#ifdef ENQUEUE_SHIM_THREADED
-        int round_robin = 0;
+        ++payloads_in_flight;
+        p->acquired = telemetry->now();
+        telemetry->acquired(next, p->acquired - t_dequeued);
 
-        while (payloads[round_robin] != nullptr) {
-          std::this_thread::sleep_for(std::chrono::microseconds(1));
+        // add the image samples to the payload
+        p->batch = qs.batch;
+        p->enqueued = qs.enqueued;
+
+        if (enqueue_threads.empty()) {
+          // Run ONE_SHOT or PIPELINE.
+          (this->*execute_ptr)(p);
+        } else {
+          // Every queue can hold all of the payloads, so the push should
+          // never fail. Should it ever, the payload is run here rather than
+          // lost with its batch.
+          if (!enqueue_queues[enqueue_next]->push(p))
+            (this->*execute_ptr)(p);
+          enqueue_next = (enqueue_next + 1) % enqueue_threads.size();
         }
-
-        payloads[round_robin] = p;
-
-        // std::cout << " " << round_robin;
-        round_robin = (round_robin + 1) % num_setup_threads;
-#else
-        // place the payload in the first slot and call shim directly
-        payloads[0] = p;
-        EnqueueShim(0);
-#endif
         break;
       }
     }
@@ -519,6 +692,35 @@ private:
     return state;
   }
 
+  // One line per device: how long each phase of the runner's init took,
+  // then the rest of the device set up and the total.
+  void PrintStartup(std::chrono::time_point<std::chrono::steady_clock> start) {
+    int64_t total = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    int64_t phases = 0;
+
+    std::cout << "Startup device " << device_id << ":";
+#ifndef NO_QAIC
+    for (auto &phase : runner->getStartupTimeline()) {
+      std::cout << " " << phase.first << " " << phase.second / 1000 << "ms,";
+      phases += phase.second;
+    }
+#endif
+    std::cout << " device " << (total - phases) / 1000 << "ms, total "
+              << total / 1000 << "ms" << std::endl;
+  }
+
+  void ReleasePayload(Payload<Sample> *p) {
+    telemetry->released(p->activation, telemetry->now() - p->acquired);
+    ring_buf[p->activation]->release(p);
+
+    if (--payloads_in_flight == 0) {
+      std::lock_guard<std::mutex> lock(mtx_idle);
+      cv_idle.notify_all();
+    }
+  }
+
   // Callback for one shot.
   static void PostResultsCallback(QAicEvent *event,
                                   QAicEventCompletionType eventCompletion,
@@ -532,11 +734,20 @@ private:
 
       // p->dptr->mtx_results.lock();
 
+      p->dptr->telemetry->completed(p->activation, p->batch->samples.size());
+
       // get the data from the hardware
       p->dptr->model->postprocessResults(
-          &(p->samples), p->dptr->buffers_out[p->activation][p->set]);
+          &(p->batch->samples), p->dptr->buffers_out[p->activation][p->set]);
+
+      p->dptr->BatchCompleted(
+          p->batch->samples.size(),
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - p->enqueued)
+              .count());
 
-      p->dptr->ring_buf[p->activation]->release(p);
+      p->batch->release();
+      p->dptr->ReleasePayload(p);
       // p->dptr->mtx_results.unlock();
     }
   }
@@ -563,20 +774,22 @@ private:
   QAicInfApi *runner;
 
   std::vector<RingBuffer<Sample> *> ring_buf;
+  // activations with a free payload
+  ActivationMask *free_activations = nullptr;
 
-  std::vector<std::vector<Sample>> samples_queue;
-  std::atomic<int> sfront, sback;
+  SPSCRing<QueuedBatch<Sample>> *samples_queue = nullptr;
   int samples_queue_depth;
 
   std::mutex mtx_queue;
   std::mutex mtx_ringbuf;
 
-  int num_setup_threads;
-  std::vector<Payload<Sample> *> payloads;
-  std::vector<std::thread> payload_threads;
+  // enqueue worker pool, fed round robin by the scheduler
+  std::vector<SPSCRing<Payload<Sample> *> *> enqueue_queues;
+  std::vector<std::thread> enqueue_threads;
+  int enqueue_next = 0;
+  std::atomic<bool> enqueue_terminate;
 
   std::thread scheduler;
-  bool shim_terminate;
   std::atomic<bool> scheduler_terminate;
 
   QAicDeviceConfig *device_cfg;
@@ -587,9 +800,17 @@ private:
   // activations, set, input buffers
   std::vector<std::vector<std::vector<void *>>> buffers_in;
 
+  // activations, set, what each input is currently bound to - the buffer
+  // above or data source memory (INPUT_SELECT 1)
+  std::vector<std::vector<std::vector<void *>>> inputs_bound;
+
   // activation, set, output buffers
   std::vector<std::vector<std::vector<void *>>> buffers_out;
 
+  // activation, set, batch size the buffers are currently shaped for
+  std::vector<std::vector<int>> batch_applied;
+  bool dynamic_batch = false;
+
   // activation, set, all buffers
   std::vector<std::vector<std::vector<void *>>> buffers_all;
 
@@ -597,6 +818,10 @@ private:
   IDataSource *data_source;
 
   int scheduler_yield_time;
+  int scheduler_spin_time;
+  // upper bound on a blocking wait, so a wake() racing with the terminate
+  // check cannot leave the scheduler asleep
+  static const int scheduler_wait_timeout = 10000;
   int enqueue_yield_time;
 
   bool loop_back;
@@ -607,9 +832,30 @@ private:
 
   int device_id;
 
-  State state;
+  // all the host cores given to the device
+  std::vector<int> device_affinity;
+
+  std::atomic<State> state;
+  std::mutex mtx_ready;
+  std::condition_variable cv_ready;
+
+  DeviceTelemetry *telemetry = nullptr;
+
+  // direct input binding (INPUT_SELECT 1) statistics
+  std::atomic<int64_t> bound_batches{0};
+  std::atomic<int64_t> copied_batches{0};
+  std::atomic<int64_t> bytes_not_copied{0};
+  std::atomic<int64_t> bytes_copied{0};
+
+  // partial batch statistics
+  std::atomic<int64_t> reshaped_sets{0};
+  std::atomic<int64_t> padded_batches{0};
 
-  int total_execution_time;
+  // payloads taken from the ring buffers and not yet released
+  std::atomic<int> payloads_in_flight{0};
+  std::mutex mtx_idle;
+  std::condition_variable cv_idle;
+  int drain_timeout;
 };
 
 template <typename Sample>
@@ -0,0 +1,125 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef SIM_DEVICE_CONFIG_H
+#define SIM_DEVICE_CONFIG_H
+
+#include "config/config_tools/config_tools.h"
+#include "iconfig.h"
+
+namespace KRAI {
+
+enum SimJitter { JITTER_NONE, JITTER_UNIFORM, JITTER_NORMAL, JITTER_EXPONENTIAL };
+
+class SimDeviceConfig : public IDeviceConfig {
+
+public:
+  SimDeviceConfig() {
+    std::string str =
+        alter_str(getconfig_c("KILT_DEVICE_SIM_JITTER"), std::string("NONE"));
+
+    if (str == "NONE") sim_jitter = JITTER_NONE;
+    else if (str == "UNIFORM") sim_jitter = JITTER_UNIFORM;
+    else if (str == "NORMAL") sim_jitter = JITTER_NORMAL;
+    else if (str == "EXPONENTIAL") sim_jitter = JITTER_EXPONENTIAL;
+    else throw std::invalid_argument("Unknown jitter distribution " + str);
+  };
+
+  // Number of batches the device services concurrently.
+  virtual const int getSlotCount() const { return sim_slots; }
+
+  virtual const int getSamplesQueueDepth() const { return samples_queue_depth; }
+
+  // Microseconds between polls of an idle scheduler that does not block.
+  virtual const int getSchedulerYieldTime() { return scheduler_yield_time; }
+  // Microseconds an idle scheduler spins before sleeping until the next
+  // batch arrives; negative keeps polling with the yield time instead.
+  virtual const int getSchedulerSpinTime() { return scheduler_spin_time; }
+
+  // Service time of a batch of n samples is
+  //   fixed + n * per_sample + jitter
+  // and is multiplied by the straggler factor with the straggler rate.
+  virtual const float getFixedCost() const { return sim_fixed_us; }
+  virtual const float getPerSampleCost() const { return sim_per_sample_us; }
+  virtual const SimJitter getJitter() const { return sim_jitter; }
+  virtual const float getJitterScale() const { return sim_jitter_us; }
+  virtual const float getStragglerRate() const { return sim_straggler_rate; }
+  virtual const float getStragglerFactor() const {
+    return sim_straggler_factor;
+  }
+
+  virtual const int getSeed() const { return sim_seed; }
+
+  // Completions are slept towards and then spun for this long, to keep the
+  // timer slack of the OS out of short service times. 0 sleeps until the
+  // due time.
+  virtual const int getSpinTime() const { return sim_spin_us; }
+
+  // Threads running postprocessResults() for completed batches, so that a
+  // slow postprocess does not hold up the completions behind it.
+  virtual const int getPostprocessThreadCount() const {
+    return sim_postprocess_threads;
+  }
+
+private:
+  const int sim_slots = alter_str_i(getconfig_c("KILT_DEVICE_SIM_SLOTS"), 1);
+
+  const int samples_queue_depth =
+      alter_str_i(getconfig_c("KILT_DEVICE_SIM_SAMPLES_QUEUE_DEPTH"), 8);
+
+  const int scheduler_yield_time =
+      alter_str_i(getconfig_c("KILT_DEVICE_SIM_SCHEDULER_YIELD_TIME"), 10);
+
+  const int scheduler_spin_time =
+      alter_str_i(getconfig_c("KILT_DEVICE_SIM_SCHEDULER_SPIN_TIME"), 0);
+
+  const float sim_fixed_us =
+      alter_str_f(getconfig_c("KILT_DEVICE_SIM_FIXED_US"), "0");
+
+  const float sim_per_sample_us =
+      alter_str_f(getconfig_c("KILT_DEVICE_SIM_PER_SAMPLE_US"), "0");
+
+  const float sim_jitter_us =
+      alter_str_f(getconfig_c("KILT_DEVICE_SIM_JITTER_US"), "0");
+
+  const float sim_straggler_rate =
+      alter_str_f(getconfig_c("KILT_DEVICE_SIM_STRAGGLER_RATE"), "0");
+
+  const float sim_straggler_factor =
+      alter_str_f(getconfig_c("KILT_DEVICE_SIM_STRAGGLER_FACTOR"), "10");
+
+  const int sim_seed = alter_str_i(getconfig_c("KILT_DEVICE_SIM_SEED"), 1);
+
+  const int sim_spin_us =
+      alter_str_i(getconfig_c("KILT_DEVICE_SIM_SPIN_US"), 0);
+
+  const int sim_postprocess_threads =
+      alter_str_i(getconfig_c("KILT_DEVICE_SIM_POSTPROCESS_THREADS"), 1);
+
+  SimJitter sim_jitter;
+};
+
+IDeviceConfig *getDeviceConfig() { return new SimDeviceConfig(); }
+
+}; // namespace KRAI
+#endif
@@ -0,0 +1,390 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef SIM_DEVICE_H
+#define SIM_DEVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+
+#include "config/device_config.h"
+#include "device_scheduler.h"
+#include "idatasource.h"
+#include "imodel.h"
+
+using namespace KRAI;
+
+// Simulated device: every batch occupies one of a fixed number of slots (the
+// sets of a single activation) for a service time drawn from the model in
+// SimDeviceConfig. Inputs are still
+// staged through configureWorkload() and results posted through
+// postprocessResults(), so the host side of the pipeline is exercised as on
+// hardware; only the device execution is replaced by a timer.
+
+template <typename Sample> struct SimPayload {
+  Batch<Sample> *batch;
+  std::chrono::time_point<std::chrono::steady_clock> enqueued;
+  std::chrono::time_point<std::chrono::steady_clock> due;
+  int activation;
+  int set;
+  std::vector<void *> buffers_in;
+  std::vector<void *> buffers_out;
+};
+
+template <typename Sample> struct SimPayloadLater {
+  bool operator()(const SimPayload<Sample> *a,
+                  const SimPayload<Sample> *b) const {
+    return a->due > b->due;
+  }
+};
+
+template <typename Sample> class SimDevice : public IDevice<Sample> {
+
+  using State = typename IDevice<Sample>::State;
+
+public:
+  SimDevice() : state(State::WAITING) {}
+
+  void Construct(IModel *_model, IDataSource *_data_source, IConfig *_config,
+                 int hw_id, std::vector<int> aff) {
+    State s = State::READY;
+    try {
+      DeviceInit(_model, _data_source, _config, hw_id, aff);
+    } catch (const std::exception &e) {
+      std::cerr << "Simulated device " << hw_id << ": " << e.what()
+                << std::endl;
+      s = State::ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_ready);
+    state = s;
+    cv_ready.notify_all();
+  }
+
+  virtual State WaitReady() {
+    std::unique_lock<std::mutex> lock(mtx_ready);
+    cv_ready.wait(lock, [this] { return state != State::WAITING; });
+    return state;
+  }
+
+  virtual int Inference(Batch<Sample> *batch) {
+    return device_scheduler->Push(batch);
+  }
+
+  virtual int GetFreeSlots() { return device_scheduler->GetFreeSlots(); }
+
+  virtual State GetState() { return state; }
+
+  ~SimDevice() {
+    if (device_scheduler) {
+      device_scheduler->Stop();
+
+      // batches still being "serviced" complete at their due time
+      if (!device_scheduler->WaitIdle(drain_timeout))
+        std::cout << "Simulated device " << device_id << ": "
+                  << device_scheduler->GetInFlight()
+                  << " payloads still in flight at shutdown" << std::endl;
+    }
+
+    if (completer.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(mtx_running);
+        completer_terminate = true;
+      }
+      cv_running.notify_all();
+      completer.join();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx_done);
+      postprocess_terminate = true;
+    }
+    cv_done.notify_all();
+    for (auto &t : postprocessors)
+      t.join();
+
+    for (int s = 0; device_scheduler && s < device_cfg->getSlotCount(); ++s) {
+      auto p = device_scheduler->GetPayload(0, s);
+      for (auto b : p->buffers_in)
+        free(b);
+      for (auto b : p->buffers_out)
+        free(b);
+    }
+    delete device_scheduler;
+
+    if (batches_serviced > 0)
+      std::cout << "Simulated device " << device_id << ": "
+                << batches_serviced << " batches, mean service time "
+                << service_time_total / batches_serviced << "us, "
+                << stragglers << " stragglers" << std::endl;
+  }
+
+private:
+  void DeviceInit(IModel *_model, IDataSource *_data_source, IConfig *_config,
+                  int hw_id, std::vector<int> aff) {
+
+    device_id = hw_id;
+
+    model = _model;
+    data_source = _data_source;
+
+    device_cfg = static_cast<SimDeviceConfig *>(_config->device_cfg);
+    model_cfg = static_cast<IModelConfig *>(_config->model_cfg);
+
+    drain_timeout = _config->server_cfg->getDrainTimeout();
+
+    // every device draws its own, reproducible, service time sequence
+    rng.seed(device_cfg->getSeed() + hw_id);
+
+    std::cout << "Creating simulated device " << hw_id << " with "
+              << device_cfg->getSlotCount() << " slots" << std::endl;
+
+    device_scheduler = new DeviceScheduler<Sample, SimPayload<Sample>>(
+        1, device_cfg->getSlotCount(), device_cfg->getSamplesQueueDepth(),
+        device_cfg->getSchedulerYieldTime(),
+        device_cfg->getSchedulerSpinTime(), &SimDevice::Dispatch, this);
+
+    for (int s = 0; s < device_cfg->getSlotCount(); ++s) {
+      auto p = device_scheduler->GetPayload(0, s);
+      for (int i = 0; i < model_cfg->getInputCount(); ++i)
+        p->buffers_in.push_back(
+            allocHostBuffer(model_cfg->getInputByteSize(i)));
+      for (int o = 0; o < model_cfg->getOutputCount(); ++o)
+        p->buffers_out.push_back(
+            allocHostBuffer(model_cfg->getOutputByteSize(o)));
+    }
+
+    completer_terminate = false;
+    postprocess_terminate = false;
+
+    // the scheduler takes the last core and the completion thread the one
+    // before it, if there is one, the postprocess threads share the rest
+    int scheduler_cpu = aff.empty() ? -1 : aff.back();
+    if (aff.size() > 1)
+      aff.pop_back();
+    device_scheduler->Start(scheduler_cpu);
+
+    completer = std::thread(&SimDevice::Completer, this);
+    if (!aff.empty()) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(aff.back(), &cpu_set);
+      pthread_setaffinity_np(completer.native_handle(), sizeof(cpu_set_t),
+                             &cpu_set);
+      if (aff.size() > 1)
+        aff.pop_back();
+    }
+
+    for (int t = 0; t < std::max(1, device_cfg->getPostprocessThreadCount());
+         ++t) {
+      postprocessors.push_back(std::thread(&SimDevice::Postprocessor, this));
+      if (!aff.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(aff[t % aff.size()], &cpu_set);
+        pthread_setaffinity_np(postprocessors.back().native_handle(),
+                               sizeof(cpu_set_t), &cpu_set);
+      }
+    }
+  }
+
+  // Draws the service time of one batch in microseconds.
+  int64_t ServiceTime(int batch_size) {
+    double us = device_cfg->getFixedCost() +
+                batch_size * device_cfg->getPerSampleCost();
+
+    double scale = device_cfg->getJitterScale();
+    switch (device_cfg->getJitter()) {
+    case JITTER_UNIFORM:
+      us += std::uniform_real_distribution<double>(0, scale)(rng);
+      break;
+    case JITTER_NORMAL:
+      us += std::normal_distribution<double>(0, scale)(rng);
+      break;
+    case JITTER_EXPONENTIAL:
+      if (scale > 0)
+        us += std::exponential_distribution<double>(1.0 / scale)(rng);
+      break;
+    default:
+      break;
+    }
+
+    if (device_cfg->getStragglerRate() > 0 &&
+        std::uniform_real_distribution<double>(0, 1)(rng) <
+            device_cfg->getStragglerRate()) {
+      us *= device_cfg->getStragglerFactor();
+      ++stragglers;
+    }
+
+    return std::max<int64_t>(0, us);
+  }
+
+  // Runs on the scheduler thread once the batch has a free slot.
+  static void Dispatch(void *handle, SimPayload<Sample> *p) {
+    SimDevice *d = static_cast<SimDevice *>(handle);
+
+    d->model->configureWorkload(d->data_source, d, &(p->batch->samples),
+                                p->buffers_in);
+
+    int64_t us = d->ServiceTime(p->batch->samples.size());
+    d->service_time_total += us;
+    ++d->batches_serviced;
+
+    p->due = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    {
+      std::lock_guard<std::mutex> lock(d->mtx_running);
+      d->running.push(p);
+    }
+    d->cv_running.notify_one();
+  }
+
+  void Completer() {
+    auto spin = std::chrono::microseconds(device_cfg->getSpinTime());
+
+    std::unique_lock<std::mutex> lock(mtx_running);
+    while (true) {
+      if (running.empty()) {
+        if (completer_terminate)
+          return;
+        cv_running.wait(lock);
+        continue;
+      }
+
+      // sleep until close to the earliest due time, a new earlier batch
+      // wakes us up through the condition variable
+      auto due = running.top()->due;
+      if (std::chrono::steady_clock::now() < due - spin) {
+        cv_running.wait_until(lock, due - spin);
+        continue;
+      }
+
+      SimPayload<Sample> *p = running.top();
+      running.pop();
+      lock.unlock();
+
+      while (std::chrono::steady_clock::now() < p->due)
+        ;
+
+      // postprocessing is left to the postprocess threads, so the next
+      // completion is not held up behind it
+      {
+        std::lock_guard<std::mutex> done_lock(mtx_done);
+        done.push_back(p);
+      }
+      cv_done.notify_one();
+
+      lock.lock();
+    }
+  }
+
+  void Postprocessor() {
+    while (true) {
+      SimPayload<Sample> *p;
+      {
+        std::unique_lock<std::mutex> lock(mtx_done);
+        cv_done.wait(lock,
+                     [this] { return postprocess_terminate || !done.empty(); });
+        if (done.empty())
+          return;
+        p = done.front();
+        done.pop_front();
+      }
+      Complete(p);
+    }
+  }
+
+  void Complete(SimPayload<Sample> *p) {
+    model->postprocessResults(&(p->batch->samples), p->buffers_out);
+
+    this->BatchCompleted(
+        p->batch->samples.size(),
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - p->enqueued)
+            .count());
+
+    p->batch->release();
+    device_scheduler->Release(p);
+  }
+
+  DeviceScheduler<Sample, SimPayload<Sample>> *device_scheduler = nullptr;
+
+  // slots in service, earliest due first
+  std::priority_queue<SimPayload<Sample> *, std::vector<SimPayload<Sample> *>,
+                      SimPayloadLater<Sample>>
+      running;
+  std::mutex mtx_running;
+  std::condition_variable cv_running;
+  std::thread completer;
+  bool completer_terminate = false;
+
+  // slots past their due time, waiting to be postprocessed
+  std::deque<SimPayload<Sample> *> done;
+  std::mutex mtx_done;
+  std::condition_variable cv_done;
+  std::vector<std::thread> postprocessors;
+  bool postprocess_terminate = false;
+
+  SimDeviceConfig *device_cfg;
+  IModelConfig *model_cfg;
+
+  std::minstd_rand rng;
+
+  IModel *model;
+  IDataSource *data_source;
+
+  int device_id;
+
+  std::atomic<State> state;
+  std::mutex mtx_ready;
+  std::condition_variable cv_ready;
+
+  // service time statistics, only touched by the scheduler
+  int64_t batches_serviced = 0;
+  int64_t service_time_total = 0;
+  int64_t stragglers = 0;
+
+  int drain_timeout = 0;
+};
+
+template <typename Sample>
+IDevice<Sample> *createDevice(IModel *_model, IDataSource *_data_source,
+                              IConfig *_config, int hw_id,
+                              std::vector<int> aff) {
+  SimDevice<Sample> *d = new SimDevice<Sample>();
+
+  std::thread t(&SimDevice<Sample>::Construct, d, _model, _data_source,
+                _config, hw_id, aff);
+  t.detach();
+
+  return d;
+}
+
+#endif // SIM_DEVICE_H
@@ -0,0 +1,133 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace KRAI {
+
+// Log-linear histogram of durations in microseconds. Values below 16 are
+// counted exactly, above that each power of two is split into 8 sub-buckets
+// (~12% resolution). Recording is lock free so it may be shared by threads.
+class LatencyHistogram {
+public:
+  LatencyHistogram() { reset(); }
+
+  void record(int64_t us) {
+    if (us < 0)
+      us = 0;
+    buckets[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    total_count.fetch_add(1, std::memory_order_relaxed);
+    total_sum.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t prev_max = max_value.load(std::memory_order_relaxed);
+    while (prev_max < (uint64_t)us &&
+           !max_value.compare_exchange_weak(prev_max, us,
+                                            std::memory_order_relaxed))
+      ;
+  }
+
+  void reset() {
+    for (int b = 0; b < NUM_BUCKETS; ++b)
+      buckets[b].store(0, std::memory_order_relaxed);
+    total_count.store(0, std::memory_order_relaxed);
+    total_sum.store(0, std::memory_order_relaxed);
+    max_value.store(0, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const {
+    return total_count.load(std::memory_order_relaxed);
+  }
+
+  uint64_t max() const { return max_value.load(std::memory_order_relaxed); }
+
+  double mean() const {
+    uint64_t n = count();
+    return n ? (double)total_sum.load(std::memory_order_relaxed) / n : 0.0;
+  }
+
+  // Upper bound of the bucket holding the requested percentile (0-100).
+  uint64_t percentile(double p) const {
+    uint64_t n = count();
+    if (n == 0)
+      return 0;
+
+    uint64_t target = (uint64_t)(p / 100.0 * n);
+    if (target >= n)
+      target = n - 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < NUM_BUCKETS; ++b) {
+      seen += buckets[b].load(std::memory_order_relaxed);
+      if (seen > target) {
+        uint64_t upper = bucketLowerBound(b + 1) - 1;
+        return upper < max() ? upper : max();
+      }
+    }
+    return max();
+  }
+
+  void print(const std::string &name) const {
+    std::cout << name << " (us): count " << count() << " mean " << mean()
+              << " p50 " << percentile(50) << " p90 " << percentile(90)
+              << " p99 " << percentile(99) << " max " << max() << std::endl;
+  }
+
+private:
+  static const int LINEAR_BUCKETS = 16;
+  static const int SUB_BUCKETS = 8;
+  static const int NUM_BUCKETS = LINEAR_BUCKETS + (64 - 4) * SUB_BUCKETS;
+
+  static int bucketIndex(uint64_t v) {
+    if (v < LINEAR_BUCKETS)
+      return v;
+    int octave = 63 - __builtin_clzll(v);
+    int sub = (v >> (octave - 3)) & (SUB_BUCKETS - 1);
+    return LINEAR_BUCKETS + (octave - 4) * SUB_BUCKETS + sub;
+  }
+
+  static uint64_t bucketLowerBound(int idx) {
+    if (idx < LINEAR_BUCKETS)
+      return idx;
+    int octave = 4 + (idx - LINEAR_BUCKETS) / SUB_BUCKETS;
+    int sub = (idx - LINEAR_BUCKETS) % SUB_BUCKETS;
+    if (octave > 63)
+      return UINT64_MAX;
+    return (uint64_t)(SUB_BUCKETS + sub) << (octave - 3);
+  }
+
+  std::atomic<uint64_t> buckets[NUM_BUCKETS];
+  std::atomic<uint64_t> total_count;
+  std::atomic<uint64_t> total_sum;
+  std::atomic<uint64_t> max_value;
+};
+
+} // namespace KRAI
+
+#endif // HISTOGRAM_H
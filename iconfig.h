@@ -34,8 +34,18 @@ namespace KRAI {
 
 class IServerConfig {
 public:
+  // How KILT picks a device for each batch
+  enum DISPATCH_POLICY { ROUND_ROBIN, LEAST_OUTSTANDING, POWER_OF_TWO };
+
   // Server config
   virtual const int getMaxWait() const = 0;
+  virtual const int getLatencyTarget() const = 0;
+
+  // Priority classes, class 0 is the default one
+  virtual const int getPriorityClassCount() const = 0;
+  virtual const int getPriorityClassMaxWait(int c) const = 0;
+  virtual const int getPriorityClassBatchCap(int c) const = 0;
+  virtual const int getPriorityClassDeadline(int c) const = 0;
   virtual const int getVerbosity() const = 0;
   virtual const int getVerbosityServer() const = 0;
   virtual const int getBatchSize() const = 0;
@@ -52,6 +62,14 @@ public:
 
   virtual const int getSchedulerYieldTime() = 0;
   virtual const int getDispatchYieldTime() = 0;
+  virtual const DISPATCH_POLICY getDispatchPolicy() = 0;
+
+  virtual const int getIngestQueueLength() = 0;
+
+  virtual const int getDrainTimeout() = 0;
+
+  virtual const int getPreprocessThreadCount() = 0;
+  virtual const std::vector<int> getPreprocessAffinity() = 0;
 };
 
 class IDeviceConfig {
@@ -91,14 +109,17 @@ public:
     std::string kilt_model_input_format(input_format);
     std::string kilt_model_output_format(output_format);
 
-    parseFormatString(kilt_model_input_format, model_input_types, model_input_dimensions);
-    parseFormatString(kilt_model_output_format, model_output_types, model_output_dimensions);
+    int dynamic = 0;
+    dynamic += parseFormatString(kilt_model_input_format, model_input_types, model_input_dimensions);
+    dynamic += parseFormatString(kilt_model_output_format, model_output_types, model_output_dimensions);
 
     model_input_count = model_input_dimensions.size();
     assert (model_input_count >= 1);
     model_output_count = model_output_dimensions.size();
     assert(model_output_count >= 1);
 
+    model_dynamic_batch = dynamic == model_input_count + model_output_count;
+
     for (int i = 0; i < model_input_count; i++) {
       int bufferSize = calculateBufferSize(getInputDimensions(i));
       int byteSize = bufferSize * getInputDatatypeSize(i);
@@ -114,9 +135,12 @@ public:
     }
   }
 
-  void parseFormatString(const std::string& kilt_model_format,
+  // Returns the number of buffers declared with a variable (-1) batch
+  // dimension.
+  int parseFormatString(const std::string& kilt_model_format,
   std::vector<IO_TYPE>& model_types,
   std::vector< std::vector<int> >& model_dimensions) {
+    int dynamic = 0;
     std::stringstream ss_ids(kilt_model_format);
     while (ss_ids.good()) {
       // get : : bounded substring
@@ -146,10 +170,12 @@ public:
         } else {
           //std::cout << "Setting variable batch size to " << model_batch_size << std::endl;
           e[0] = model_batch_size;
+          ++dynamic;
         }
       }
       model_dimensions.push_back(e);
     }
+    return dynamic;
   }
 
   const int calculateBufferSize(const std::vector<int>& dimensions) {
@@ -217,6 +243,10 @@ public:
 
   virtual const int getBatchSize() const { return model_batch_size; }
 
+  // True when every input and output has a variable batch dimension, so the
+  // buffers can be resized to a partial batch instead of padded.
+  virtual const bool hasDynamicBatch() const { return model_dynamic_batch; }
+
   virtual const IO_TYPE getInputDatatype(const int buf_idx) const {
     return model_input_types.at(buf_idx);
   }
@@ -269,6 +299,7 @@ private:
   int model_input_count;
   int model_output_count;
   int model_batch_size;
+  bool model_dynamic_batch;
 
   std::vector<std::vector<int>> model_input_dimensions;
   std::vector<std::vector<int>> model_output_dimensions;
@@ -25,22 +25,32 @@
 #ifndef IDEVICE_H
 #define IDEVICE_H
 
+#include <chrono>
 #include <iostream>
+#include <thread>
 
+#include "batch.h"
+#include "copy_kernels.h"
+#include "device_telemetry.h"
 #include "idatasource.h"
 #include "imodel.h"
 
-#if defined(__amd64__) && defined(ENABLE_ZEN2)
-#include <cstdint>
-#include <immintrin.h>
-#endif
-
 using namespace KRAI;
 
+// A batch waiting in a device's samples queue, with the time it was handed
+// to the device.
+template <typename Sample> struct QueuedBatch {
+  Batch<Sample> *batch;
+  std::chrono::time_point<std::chrono::steady_clock> enqueued;
+};
+
 template <typename Sample> class IDevice {
 
 public:
-  virtual int Inference(std::vector<Sample> samples) = 0;
+  // Takes ownership of the batch on success (returns the free slots left)
+  // and releases it once results are posted. Returns -1 when full, in which
+  // case the caller keeps the batch.
+  virtual int Inference(Batch<Sample> *batch) = 0;
 
   enum class State {
     READY,
@@ -50,38 +60,57 @@ public:
 
   virtual State GetState() { return State::READY; }
 
+  // Blocks until the device has finished initialising, then returns its
+  // state (READY or ERROR). Backends that initialise asynchronously should
+  // override this, the default polls GetState().
+  virtual State WaitReady() {
+    State s;
+    while ((s = GetState()) == State::WAITING)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return s;
+  }
+
+  // Number of batches the device can currently accept, or -1 if the
+  // backend cannot tell (KILT then uses the last Inference() result).
+  virtual int GetFreeSlots() { return -1; }
+
+  // Called by the device as each batch completes, with its sample count and
+  // the microseconds it spent on the device from Inference() to results.
+  typedef void (*CompletionCallback)(void *handle, int batch_size,
+                                     int64_t us);
+
+  // Live utilisation and queueing counters, readable while the device runs,
+  // or nullptr if the backend keeps none.
+  virtual const DeviceTelemetry *GetTelemetry() const { return nullptr; }
+
+  virtual void SetCompletionCallback(CompletionCallback callback,
+                                     void *handle) {
+    completion_callback = callback;
+    completion_handle = handle;
+  }
+
   // Default implementation of SyncData - optimised copy from src to dest
   // Override if backend specific copy is required.
-  virtual void SyncData(void * src, void * dest, int offset, size_t size){
-
-#if defined(__amd64__) && defined(ENABLE_ZEN2)
-
-  __m256i *dest_ptr = reinterpret_cast<__m256i *>((uint8_t *)dest+offset);
-
-  // ensure both input and output buffers are 256 byte aligned.
-  if( !(reinterpret_cast<uintptr_t>(src) & 0xff) && !(reinterpret_cast<uintptr_t>(dest_ptr) & 0xff)) {
-      const __m256i *src_ptr = reinterpret_cast<const __m256i *>(src);
-      int64_t vectors = size / sizeof(*src_ptr);
-      for (; vectors > 0; vectors--, src_ptr++, dest_ptr++) {
-        const __m256i loaded = _mm256_stream_load_si256(src_ptr);
-        _mm256_stream_si256(dest_ptr, loaded);
-      }
-      unsigned rem = size % sizeof(*src_ptr);
-      if (rem > 0) {
-        memcpy((uint8_t *)dest_ptr, (uint8_t *)src_ptr, rem);
-      }
-      _mm_sfence();
-  } else {
-      // fallback for non aligned buffers
-      std::copy((uint8_t *)src, (uint8_t *)src + size, (uint8_t *)dest + offset);
-  }
-#else
-      std::copy((uint8_t *)src, (uint8_t *)src + size, (uint8_t *)dest + offset);
-#endif
+  virtual void SyncData(void *src, void *dest, int offset, size_t size) {
+    copyData((uint8_t *)dest + offset, src, size);
+  };
 
+  // Zero size bytes of dest from offset.
+  // Override if backend specific copy is required.
+  virtual void ZeroData(void *dest, int offset, size_t size) {
+    zeroData((uint8_t *)dest + offset, size);
   };
 
   virtual ~IDevice(){};
+
+protected:
+  void BatchCompleted(int batch_size, int64_t us) {
+    if (completion_callback)
+      completion_callback(completion_handle, batch_size, us);
+  }
+
+  CompletionCallback completion_callback = nullptr;
+  void *completion_handle = nullptr;
 };
 
 template <typename Sample>
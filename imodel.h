@@ -50,6 +50,15 @@ public:
     throw std::runtime_error("This variant of configWorkload() not implemented.");
   };
 
+  // If the batch's data for input buf_idx already lies back to back in
+  // memory, in batch order and for a full batch, returns where it starts so
+  // the device can bind its input there instead of copying. Returns nullptr
+  // when the input has to be staged by configureWorkload().
+  virtual void *getContiguousInput(IDataSource *data_source,
+                                   const void *samples, int buf_idx) {
+    return nullptr;
+  }
+
   virtual void postprocessResults(void *samples,
                                   std::vector<void *> &out_ptrs) = 0;
 
@@ -24,6 +24,10 @@
 #endif
 #ifdef KILT_DEVICE_QAIC
 #include "devices/qaic/device.h"
+#elif KILT_DEVICE_CPU
+#include "devices/cpu/device.h"
+#elif KILT_DEVICE_SIM
+#include "devices/sim/device.h"
 #elif KILT_DEVICE_NONE
 #else
 #endif
@@ -30,8 +30,16 @@
 #include "imodel.h"
 
 #include "config/kilt_config.h"
+#include "batch.h"
+#include "batch_controller.h"
+#include "histogram.h"
+#include "mpsc_queue.h"
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <random>
+#include <sched.h>
 
 using namespace KRAI;
 
@@ -41,12 +49,59 @@ public:
 
     config = new IConfig();
 
-    scheduler_yield_time = config->server_cfg->getSchedulerYieldTime();
     dispatch_yield_time = config->server_cfg->getDispatchYieldTime();
+    dispatch_policy = config->server_cfg->getDispatchPolicy();
+    max_wait = std::chrono::microseconds(config->server_cfg->getMaxWait());
+
+    // adaptive flush deadline, bounded by max_wait, when a latency target
+    // is given
+    if (config->server_cfg->getLatencyTarget() > 0)
+      batch_controller = new AdaptiveBatchController(
+          config->server_cfg->getBatchSize(),
+          config->server_cfg->getLatencyTarget(),
+          config->server_cfg->getMaxWait());
+    else
+      batch_controller = nullptr;
 
     terminate = false;
+    former_sleeping = false;
+
+    accepting = true;
+    drain_pending = false;
+    drained = false;
+
+    submitted_samples = 0;
+    completed_samples = 0;
+    completion_waiters = 0;
+
+    // priority classes - class 0 is the default one
+    for (int c = 0; c < config->server_cfg->getPriorityClassCount(); ++c) {
+      PriorityClass pc;
+      pc.max_wait = std::chrono::microseconds(
+          config->server_cfg->getPriorityClassMaxWait(c));
+      pc.batch_cap =
+          std::max(1, std::min(config->server_cfg->getPriorityClassBatchCap(c),
+                               config->server_cfg->getBatchSize()));
+      pc.deadline = std::chrono::microseconds(
+          config->server_cfg->getPriorityClassDeadline(c));
+      classes.push_back(pc);
+
+      ingest_queues.push_back(
+          new MPSCQueue<Sample>(config->server_cfg->getIngestQueueLength()));
+
+      if (classes.size() > 1)
+        std::cout << "Priority class " << c << ": max wait "
+                  << pc.max_wait.count() << "us batch cap " << pc.batch_cap
+                  << " deadline " << pc.deadline.count() << "us"
+                  << std::endl;
+    }
+    class_latency = new LatencyHistogram[classes.size()];
 
-    scheduler = std::thread(&KraiInferenceLibrary::Scheduler, this);
+    // enough batches for the open ones plus a generous share per device,
+    // the pool grows if this is ever exceeded
+    batch_pool = new BatchPool<Sample>(
+        classes.size() * 2 + config->server_cfg->getDeviceCount() * 64,
+        config->server_cfg->getBatchSize());
 
     model = modelConstruct(config);
 
@@ -64,6 +119,8 @@ public:
 
     n_devices = config->server_cfg->getDeviceCount();
 
+    auto t_devices = std::chrono::steady_clock::now();
+
     for (int dv = 0; dv < n_devices; ++dv) {
 
       unsigned int device_id = config->server_cfg->getDeviceId(dv);
@@ -83,36 +140,141 @@ public:
                                device_id, device_affinity);
 
       devices.push_back(device);
+      device_data_source.push_back(data_source_id);
+
+    }
 
+    // One group per data source holding the devices it feeds. A batch is
+    // preprocessed and dispatched within a single group so that samples
+    // never leave the node their data source lives on.
+    for (int ds = 0; ds < data_sources.size(); ++ds) {
+      DeviceGroup *g = new DeviceGroup();
+      g->data_source = ds;
+      g->preprocess_queue.reserve(256);
+      g->affinity = config->server_cfg->getDataSourceAffinity(ds);
+      for (int dv = 0; dv < n_devices; ++dv)
+        if (device_data_source[dv] == ds)
+          g->devices.push_back(dv);
+      groups.push_back(g);
+
+      if (!g->devices.empty())
+        active_groups.push_back(g);
+    }
+
+    if (active_groups.empty())
+      throw std::runtime_error("No devices configured");
+
+    for (int dv = 0; dv < n_devices; ++dv) {
+      std::vector<int> device_affinity = config->server_cfg->getDeviceAffinity(
+          config->server_cfg->getDeviceId(dv));
+      const std::vector<int> &ds_affinity =
+          groups[device_data_source[dv]]->affinity;
+
+      bool shared = false;
+      for (int c : device_affinity)
+        shared |= std::find(ds_affinity.begin(), ds_affinity.end(), c) !=
+                  ds_affinity.end();
+      if (!shared)
+        std::cout << "WARNING: Device [" << dv
+                  << "] shares no cores with its data source "
+                  << device_data_source[dv] << std::endl;
     }
     
-    // Loop until all devices are ready.
+    // Wait for all devices to be ready, they come up in parallel.
+    std::cout << "Devices ready after:";
     for (int dv = 0; dv < n_devices; ++dv) {
-      switch (devices[dv]->GetState()) {
-      case IDevice<Sample>::State::READY:
-	break;
-      case IDevice<Sample>::State::WAITING:
-	--dv;
-	break;
-      case IDevice<Sample>::State::ERROR:
+      if (devices[dv]->WaitReady() == IDevice<Sample>::State::ERROR)
         throw std::runtime_error("Device Error");
-      }
+      std::cout << " [" << dv << "] "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - t_devices)
+                       .count()
+                << "ms";
     }
+    std::cout << std::endl;
+
+    queue_len = std::vector<std::atomic<int>>(n_devices);
 
-    queue_len = std::vector<uint64_t>(n_devices, 0);
+    for (int dv = 0; dv < n_devices; ++dv)
+      devices[dv]->SetCompletionCallback(CompletionImpl, this);
 
     // diagnostics
     batch_trace = std::vector<uint64_t>(config->server_cfg->getBatchSize(), 0);
     distribution =
         std::vector<uint64_t>(n_devices, 0);
+
+    // Preprocessing stage - closed batches are handed over by the batch
+    // former so that model preprocessing (e.g. BERT packing) never delays
+    // ingest. Each active group gets its own workers, pinned to the cores
+    // of its data source unless an explicit affinity list is given.
+    preprocess_terminate = false;
+
+    int n_preprocess = config->server_cfg->getPreprocessThreadCount();
+    const std::vector<int> preprocess_affinity =
+        config->server_cfg->getPreprocessAffinity();
+
+    preprocess_contexts.resize(n_preprocess * active_groups.size());
+
+    for (int t = 0; t < preprocess_contexts.size(); ++t) {
+      DeviceGroup *g = active_groups[t / n_preprocess];
+
+      preprocess_contexts[t].kilt = this;
+      preprocess_contexts[t].group = g;
+      preprocess_threads.push_back(std::thread(
+          &KraiInferenceLibrary::PreprocessWorker, this,
+          &preprocess_contexts[t]));
+
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+
+      std::cout << "Preprocess thread " << t << " (data source "
+                << g->data_source << ") affinity: ";
+      if (!preprocess_affinity.empty()) {
+        int cpu = preprocess_affinity[t % preprocess_affinity.size()];
+        std::cout << cpu;
+        CPU_SET(cpu, &cpu_set);
+      } else {
+        for (int cpu : g->affinity) {
+          std::cout << cpu << " ";
+          CPU_SET(cpu, &cpu_set);
+        }
+      }
+      std::cout << std::endl;
+
+      if (CPU_COUNT(&cpu_set))
+        pthread_setaffinity_np(preprocess_threads.back().native_handle(),
+                               sizeof(cpu_set_t), &cpu_set);
+    }
+
+    // Start the batch former last, once the devices, groups and workers it
+    // hands batches to all exist.
+    scheduler = std::thread(&KraiInferenceLibrary::Scheduler, this);
   }
 
   ~KraiInferenceLibrary() {
 
+    if (!drained)
+      Drain(config->server_cfg->getDrainTimeout());
+
+    mtx_former.lock();
     terminate = true;
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    mtx_former.unlock();
+    cv_former.notify_one();
     scheduler.join();
 
+    // let the workers finish whatever the former has already closed
+    preprocess_terminate = true;
+    for (DeviceGroup *g : groups) {
+      g->mtx_preprocess.lock();
+      g->mtx_preprocess.unlock();
+      g->cv_preprocess.notify_all();
+    }
+    for (auto &t : preprocess_threads)
+      t.join();
+
+    for (auto q : ingest_queues)
+      delete q;
+
     for (int d = 0; d < n_devices; ++d) {
       delete devices[d];
     }
@@ -125,6 +287,35 @@ public:
       std::cout << batch_trace[t] << " ";
     std::cout << std::endl;
 
+    flush_lateness.print("Timeout flush lateness");
+    batch_fill_time.print("Stage form: batch fill time");
+    preprocess_queue_wait.print("Stage preprocess: queue wait");
+    preprocess_time.print("Stage preprocess: processing time");
+    dispatch_time.print("Stage dispatch: time to hand over to a device");
+
+    for (int c = 0; c < classes.size(); ++c)
+      class_latency[c].print("Class " + std::to_string(c) +
+                             ": ingest to dispatch (oldest sample)");
+    delete[] class_latency;
+
+    std::cout << "Batch pool size: " << batch_pool->size() << std::endl;
+    delete batch_pool;
+
+    if (batch_controller) {
+      batch_controller->print();
+      delete batch_controller;
+    }
+
+    for (DeviceGroup *g : groups) {
+      if (!g->devices.empty())
+        std::cout << "DataSource [" << g->data_source << "]: batches "
+                  << g->batches << " samples " << g->samples
+                  << " queue depth max " << g->preprocess_queue_depth_max
+                  << " preprocessed off node " << g->remote_preprocess
+                  << std::endl;
+      delete g;
+    }
+
     delete model;
   }
 
@@ -147,38 +338,133 @@ public:
 
   static void DispatchImpl(void *handle, const void *samples) {
 
-    KraiInferenceLibrary<Sample> *ths =
-        reinterpret_cast<KraiInferenceLibrary<Sample> *>(handle);
+    PreprocessContext *ctx = reinterpret_cast<PreprocessContext *>(handle);
 
     const std::vector<Sample> *s =
         reinterpret_cast<const std::vector<Sample> *>(samples);
 
-    ths->Dispatch(*s);
+    auto t_before = std::chrono::steady_clock::now();
+
+    // Models that dispatch the batch they were given hand it over as is,
+    // anything they build themselves (e.g. BERT packs) goes into a batch
+    // from the pool.
+    Batch<Sample> *b;
+    if (s == &ctx->current->samples && !ctx->handed_over) {
+      b = ctx->current;
+      ctx->handed_over = true;
+    } else {
+      b = ctx->kilt->batch_pool->acquire();
+      b->samples.assign(s->begin(), s->end());
+    }
+
+    ctx->kilt->Dispatch(ctx->group, b);
+
+    auto t_after = std::chrono::steady_clock::now();
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                     t_after - t_before)
+                     .count();
+    ctx->dispatch_us += us;
+    ctx->kilt->dispatch_time.record(us);
   }
 
-  void Inference(const std::vector<Sample> &samples) {
+  static void CompletionImpl(void *handle, int batch_size, int64_t us) {
+    KraiInferenceLibrary<Sample> *ths =
+        reinterpret_cast<KraiInferenceLibrary<Sample> *>(handle);
 
-    int num_samples = samples.size();
+    if (ths->batch_controller)
+      ths->batch_controller->recordService(batch_size, us);
 
-    for (int s = 0; s < num_samples; ++s) {
+    ths->completed_samples.fetch_add(batch_size);
+    ths->NotifyCompletionWaiters();
+  }
 
-      mtx_samples_queue.lock();
+  // same pattern as waking the batch former - only lock when someone is
+  // actually waiting
+  void NotifyCompletionWaiters() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (completion_waiters.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mtx_completion);
+      cv_completion.notify_all();
+    }
+  }
 
-      samples_queue.emplace_back(samples[s]);
+  // The flush deadline currently in use and the estimates behind it.
+  BatchingDecision GetBatchingDecision() {
+    if (batch_controller)
+      return batch_controller->getDecision();
+    return {max_wait.count(), config->server_cfg->getBatchSize(), 0.0, 0.0,
+            0.0};
+  }
 
-      if (samples_queue.size() == config->server_cfg->getBatchSize()) {
+  // Samples of a priority class other than 0 are batched separately with
+  // that class' max wait, batch cap and deadline. Returns false, dropping
+  // the samples, for an unknown class or once Drain() has started.
+  bool Inference(const std::vector<Sample> &samples, int priority_class = 0) {
+
+    if (priority_class < 0 || priority_class >= ingest_queues.size()) {
+      if (!unknown_class_logged.exchange(true))
+        std::cerr << "KILT: dropping samples of unknown priority class "
+                  << priority_class << " (" << ingest_queues.size()
+                  << " configured), further ones are dropped silently"
+                  << std::endl;
+      return false;
+    }
 
-        ++batch_trace[samples_queue.size() - 1];
+    // Count the samples before checking admission, so that Drain(), which
+    // closes admission before reading the count, either sees them or we see
+    // admission closed. In the latter case the count is taken back.
+    submitted_samples.fetch_add(samples.size());
+    if (!accepting) {
+      submitted_samples.fetch_sub(samples.size());
+      NotifyCompletionWaiters();
+      return false;
+    }
 
-        model->preprocessSamples(data_sources[0], &samples_queue, this,
-                                 DispatchImpl);
+    ingest_queues[priority_class]->push(samples.data(), samples.size());
 
-        // Dispatch(samples_queue);
-        samples_queue.clear();
-        prev = std::chrono::steady_clock::now();
-      }
-      mtx_samples_queue.unlock();
+    // Only take the lock when the batch former is asleep. The fence pairs
+    // with the one in Scheduler() so that either we see it sleeping or it
+    // sees the samples we have just published.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (former_sleeping.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mtx_former);
+      cv_former.notify_one();
     }
+
+    return true;
+  }
+
+  uint64_t Drain() { return Drain(config->server_cfg->getDrainTimeout()); }
+
+  // Stops admission, flushes the partial batches straight away and waits up
+  // to timeout_ms for the samples in flight. Returns how many were drained.
+  uint64_t Drain(int64_t timeout_ms) {
+
+    auto t_start = std::chrono::steady_clock::now();
+
+    accepting = false;
+    uint64_t in_flight = GetInFlightSampleCount();
+
+    mtx_former.lock();
+    drain_pending = true;
+    mtx_former.unlock();
+    cv_former.notify_one();
+
+    bool done = WaitForCompletion(timeout_ms);
+
+    uint64_t left = GetInFlightSampleCount();
+    drained = true;
+
+    std::cout << "KILT drained " << in_flight - left << " samples in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - t_start)
+                     .count()
+              << "ms";
+    if (!done)
+      std::cout << ", timed out with " << left << " still in flight";
+    std::cout << std::endl;
+
+    return in_flight - left;
   }
 
   void LoadNextBatch(void *user) {
@@ -219,32 +505,235 @@ public:
     }
   }
 
+  // Every data source holds the full loaded set, so report what all of
+  // them can provide.
   const int AvailableSamplesMax() {
-    return data_sources[0]->getNumAvailableSampleFiles();
+    int available = data_sources[0]->getNumAvailableSampleFiles();
+    for (int ds = 1; ds < data_sources.size(); ++ds)
+      available =
+          std::min(available, data_sources[ds]->getNumAvailableSampleFiles());
+    return available;
   }
 
   const int SamplesInMemoryMax() {
-    return data_sources[0]->getNumMaxSamplesInMemory();
+    int in_memory = data_sources[0]->getNumMaxSamplesInMemory();
+    for (int ds = 1; ds < data_sources.size(); ++ds)
+      in_memory =
+          std::min(in_memory, data_sources[ds]->getNumMaxSamplesInMemory());
+    return in_memory;
   }
 
   const std::string &UniqueServerID() {
     return config->server_cfg->getUniqueServerID();
   }
   
-  int GetCompletedSampleCount() const {
-    return model->getCompletedSampleCount();
+  uint64_t GetSubmittedSampleCount() const { return submitted_samples; }
+
+  uint64_t GetCompletedSampleCount() const { return completed_samples; }
+
+  // Telemetry of device dv (in KILT_DEVICE_IDS order), or nullptr if its
+  // backend keeps none. Safe to read while inference runs.
+  const DeviceTelemetry *GetDeviceTelemetry(int dv) const {
+    return devices[dv]->GetTelemetry();
+  }
+
+  // Prints the telemetry of every device that keeps it.
+  void PrintDeviceTelemetry(std::ostream &os) const {
+    for (int dv = 0; dv < n_devices; ++dv)
+      if (const DeviceTelemetry *t = devices[dv]->GetTelemetry())
+        t->print(os, config->server_cfg->getDeviceId(dv));
+  }
+
+  uint64_t GetInFlightSampleCount() const {
+    uint64_t completed = completed_samples;
+    return submitted_samples - completed;
+  }
+
+  // Blocks until every sample submitted before the call has completed, or
+  // until timeout_ms has passed (negative waits forever). Returns true if
+  // the work drained.
+  bool WaitForCompletion(int64_t timeout_ms = -1) {
+
+    const uint64_t target = submitted_samples;
+
+    std::unique_lock<std::mutex> lock(mtx_completion);
+    ++completion_waiters;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // the target may include samples Inference() counted and then took
+    // back, so it never exceeds what is currently submitted
+    auto drained = [this, target] {
+      return completed_samples >= std::min<uint64_t>(target, submitted_samples);
+    };
+
+    bool done;
+    if (timeout_ms < 0) {
+      cv_completion.wait(lock, drained);
+      done = true;
+    } else {
+      done = cv_completion.wait_for(
+          lock, std::chrono::milliseconds(timeout_ms), drained);
+    }
+
+    --completion_waiters;
+    return done;
   }
 
 private:
-  int round_robin = 0;
-  void Dispatch(const std::vector<Sample> &samples) {
+  struct PriorityClass {
+    std::chrono::microseconds max_wait;
+    int batch_cap;
+    std::chrono::microseconds deadline;
+  };
+
+  // batch being formed by the batch former
+  struct OpenBatch {
+    Batch<Sample> *batch;
+    std::chrono::time_point<std::chrono::steady_clock> opened;
+    std::chrono::time_point<std::chrono::steady_clock> flush_at;
+    std::chrono::time_point<std::chrono::steady_clock> edf;
+  };
+
+  struct PendingBatch {
+    Batch<Sample> *batch;
+    int priority_class;
+    std::chrono::time_point<std::chrono::steady_clock> opened;
+    std::chrono::time_point<std::chrono::steady_clock> closed;
+    std::chrono::time_point<std::chrono::steady_clock> edf;
+  };
+
+  // A data source and the devices bound to it, with the queue of closed
+  // batches waiting to be preprocessed against that data source.
+  struct DeviceGroup {
+    int data_source;
+    std::vector<int> affinity;
+    std::vector<int> devices;
+
+    int round_robin = 0;
+    std::minstd_rand dispatch_rng;
+    std::mutex mtx_dispatch;
+
+    // kept in deadline order
+    std::vector<PendingBatch> preprocess_queue;
+    std::mutex mtx_preprocess;
+    std::condition_variable cv_preprocess;
+
+    // batches queued or being preprocessed
+    std::atomic<int> pending{0};
+
+    // diagnostics
+    size_t preprocess_queue_depth_max = 0;
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> remote_preprocess{0};
+  };
+
+  // Per preprocessing worker state, passed to the model as the dispatch
+  // handle.
+  struct PreprocessContext {
+    KraiInferenceLibrary<Sample> *kilt;
+    DeviceGroup *group;
+    int64_t dispatch_us;
+
+    // batch being preprocessed and whether it went to a device as is
+    Batch<Sample> *current;
+    bool handed_over;
+  };
+
+  // position in devices[] used to spread batches over groups round robin
+  int group_cursor = 0;
+
+  // Free slots on a device - asks the device if it can tell, otherwise
+  // falls back on what its last Inference() call returned.
+  int FreeSlots(int dv) {
+    int free = devices[dv]->GetFreeSlots();
+    return free >= 0 ? free : queue_len[dv].load();
+  }
+
+  // Picks a device within the group, returns its index in devices[].
+  int SelectDevice(DeviceGroup *g) {
+
+    const int n = g->devices.size();
+    int selected = g->round_robin;
+
+    switch (dispatch_policy) {
+    case IServerConfig::ROUND_ROBIN:
+      break;
+    case IServerConfig::LEAST_OUTSTANDING: {
+      // ties go to the round robin position so that idle devices are
+      // still filled evenly
+      int best = FreeSlots(g->devices[selected]);
+      for (int i = 1; i < n; ++i) {
+        int idx = (g->round_robin + i) % n;
+        int free = FreeSlots(g->devices[idx]);
+        if (free > best) {
+          best = free;
+          selected = idx;
+        }
+      }
+      break;
+    }
+    case IServerConfig::POWER_OF_TWO: {
+      if (n < 2)
+        break;
+      int a = g->dispatch_rng() % n;
+      int b = g->dispatch_rng() % (n - 1);
+      if (b >= a)
+        ++b;
+      selected =
+          FreeSlots(g->devices[b]) > FreeSlots(g->devices[a]) ? b : a;
+      break;
+    }
+    }
+
+    g->round_robin = (selected + 1) % n;
+    return g->devices[selected];
+  }
+
+  // Picks the group a closed batch goes to. Round robin follows the device
+  // order so each group gets work in proportion to its device count; the
+  // load aware policies pick the group with the most spare capacity.
+  DeviceGroup *SelectGroup() {
+
+    if (active_groups.size() == 1)
+      return active_groups[0];
+
+    if (dispatch_policy == IServerConfig::ROUND_ROBIN) {
+      DeviceGroup *g = groups[device_data_source[group_cursor]];
+      group_cursor = (group_cursor + 1) % n_devices;
+      return g;
+    }
+
+    DeviceGroup *selected = nullptr;
+    int best = 0;
+    for (int i = 0; i < active_groups.size(); ++i) {
+      DeviceGroup *g =
+          active_groups[(group_cursor + i) % active_groups.size()];
+      int spare = -g->pending;
+      for (int dv : g->devices)
+        spare += FreeSlots(dv);
+      if (selected == nullptr || spare > best) {
+        best = spare;
+        selected = g;
+      }
+    }
+    group_cursor = (group_cursor + 1) % active_groups.size();
+    return selected;
+  }
+
+  // Hands the batch over to a device, which releases it when done.
+  void Dispatch(DeviceGroup *g, Batch<Sample> *batch) {
+
+    // called concurrently by the group's preprocessing workers
+    std::lock_guard<std::mutex> lock(g->mtx_dispatch);
 
     int done;
+    int dv;
 
     while (1) {
-      done = devices[round_robin]->Inference(samples);
-      queue_len[round_robin] = done;
-      round_robin = (round_robin + 1) % n_devices;
+      dv = SelectDevice(g);
+      done = devices[dv]->Inference(batch);
+      queue_len[dv] = done;
 
       if (done >= 0)
         break;
@@ -254,7 +743,7 @@ private:
             std::chrono::microseconds(dispatch_yield_time));
     }
 
-    ++distribution[round_robin];
+    ++distribution[dv];
 
 #if 0
     static int counter = 0;
@@ -277,66 +766,307 @@ private:
 #endif
   }
 
-  void Scheduler() {
+  // Queue a closed batch for preprocessing, earliest deadline first.
+  void FlushBatch(int priority_class, OpenBatch &b) {
+
+    auto now = std::chrono::steady_clock::now();
+    batch_fill_time.record(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - b.opened)
+            .count());
+
+    ++batch_trace[b.batch->samples.size() - 1];
+
+    DeviceGroup *g = SelectGroup();
+    ++g->pending;
+
+    g->mtx_preprocess.lock();
+    auto pos = std::upper_bound(
+        g->preprocess_queue.begin(), g->preprocess_queue.end(), b.edf,
+        [](const std::chrono::time_point<std::chrono::steady_clock> &edf,
+           const PendingBatch &p) { return edf < p.edf; });
+    g->preprocess_queue.insert(
+        pos, {b.batch, priority_class, b.opened, now, b.edf});
+    if (g->preprocess_queue.size() > g->preprocess_queue_depth_max)
+      g->preprocess_queue_depth_max = g->preprocess_queue.size();
+    g->mtx_preprocess.unlock();
+    g->cv_preprocess.notify_one();
+  }
+
+  void PreprocessWorker(PreprocessContext *ctx) {
+
+    DeviceGroup *g = ctx->group;
+
+    while (true) {
+      PendingBatch batch;
+      {
+        std::unique_lock<std::mutex> lock(g->mtx_preprocess);
+        g->cv_preprocess.wait(lock, [this, g] {
+          return preprocess_terminate || !g->preprocess_queue.empty();
+        });
+        if (g->preprocess_queue.empty())
+          break;
 
-    prev = std::chrono::steady_clock::now();
-    std::chrono::microseconds max_wait =
-        std::chrono::microseconds(config->server_cfg->getMaxWait());
+        batch = g->preprocess_queue.front();
+        g->preprocess_queue.erase(g->preprocess_queue.begin());
+      }
+
+      // cross node traffic - the worker is reading the data source from
+      // a core outside the data source's own set
+      int cpu = sched_getcpu();
+      if (!g->affinity.empty() &&
+          std::find(g->affinity.begin(), g->affinity.end(), cpu) ==
+              g->affinity.end())
+        ++g->remote_preprocess;
+      ++g->batches;
+      g->samples += batch.batch->samples.size();
+
+      auto t_start = std::chrono::steady_clock::now();
+      preprocess_queue_wait.record(
+          std::chrono::duration_cast<std::chrono::microseconds>(t_start -
+                                                                batch.closed)
+              .count());
+
+      ctx->dispatch_us = 0;
+      ctx->current = batch.batch;
+      ctx->handed_over = false;
+      model->preprocessSamples(data_sources[g->data_source],
+                               &batch.batch->samples, ctx, DispatchImpl);
+      if (!ctx->handed_over)
+        batch.batch->release();
+      --g->pending;
+
+      auto t_end = std::chrono::steady_clock::now();
+
+      if (batch_controller)
+        batch_controller->recordOverhead(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                t_end - batch.closed)
+                .count());
+      preprocess_time.record(
+          std::chrono::duration_cast<std::chrono::microseconds>(t_end -
+                                                                t_start)
+              .count() -
+          ctx->dispatch_us);
+      class_latency[batch.priority_class].record(
+          std::chrono::duration_cast<std::chrono::microseconds>(t_end -
+                                                                batch.opened)
+              .count());
+    }
+  }
+
+  // Batch former - the single consumer of the ingest queues. Each priority
+  // class has its own open batch, flushed as soon as it reaches the class
+  // batch cap, or once its first sample has waited the class max wait.
+  // Batches closed together are handed over earliest deadline first. Sleeps
+  // until either the next flush deadline or the arrival of new samples, so
+  // no time is spent polling.
+  void Scheduler() {
 
     std::cout << "MaxWait: " << config->server_cfg->getMaxWait() << std::endl;
 
-    while (!terminate) {
-      auto now = std::chrono::steady_clock::now();
-      mtx_samples_queue.lock();
-      int qlen = samples_queue.size();
+    const int n_classes = classes.size();
+
+    std::vector<OpenBatch> open(n_classes);
+    for (int c = 0; c < n_classes; ++c)
+      open[c].batch = batch_pool->acquire();
+
+    std::vector<std::pair<int, OpenBatch>> ready;
+    ready.reserve(64);
+
+    while (true) {
+
+      // top up the open batches straight from the ingest queues
+      for (int c = 0; c < n_classes; ++c) {
+        OpenBatch &b = open[c];
+        const int cap = classes[c].batch_cap;
+
+        while (true) {
+          std::vector<Sample> &samples = b.batch->samples;
+          int qlen = samples.size();
+          samples.resize(cap);
+          int n = ingest_queues[c]->pop(samples.data() + qlen, cap - qlen);
+          samples.resize(qlen + n);
+
+          if (n == 0)
+            break;
+
+          if (c == 0 && batch_controller)
+            batch_controller->recordArrivals(n);
+
+          if (qlen == 0)
+            OpenClassBatch(c, b);
+
+          if (samples.size() == cap) {
+            ready.push_back({c, b});
+            b.batch = batch_pool->acquire();
+          }
+        }
+      }
+
+      // once draining, partial batches go out without waiting
+      drain_pending = false;
+      const bool draining = !accepting;
+
+      if (!terminate) {
+        auto now = std::chrono::steady_clock::now();
+        for (int c = 0; c < n_classes; ++c) {
+          OpenBatch &b = open[c];
+          if (b.batch->samples.empty() || (now < b.flush_at && !draining))
+            continue;
+
+          int64_t lateness =
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  now - b.flush_at)
+                  .count();
+          if (lateness >= 0)
+            flush_lateness.record(lateness);
 
-      if (qlen) {
-        if ((now - prev) > max_wait) {
           if (config->server_cfg->getVerbosityServer())
-            std::cout << "(" << qlen << ")";
-
-          ++batch_trace[samples_queue.size() - 1];
-          // std::cout << "Timeout triggered." << std::endl;
-          model->preprocessSamples(data_sources[0], &samples_queue, this,
-                                   DispatchImpl);
-          // Dispatch(samples_queue);
-          samples_queue.clear();
-          prev = now;
+            std::cout << "(" << b.batch->samples.size() << ",+" << lateness
+                      << "us)";
+
+          ready.push_back({c, b});
+          b.batch = batch_pool->acquire();
         }
-      } else {
-        prev = now;
       }
-      mtx_samples_queue.unlock();
-      std::this_thread::sleep_for(
-          std::chrono::microseconds(scheduler_yield_time));
+
+      std::stable_sort(ready.begin(), ready.end(),
+                       [](const std::pair<int, OpenBatch> &a,
+                          const std::pair<int, OpenBatch> &b) {
+                         return a.second.edf < b.second.edf;
+                       });
+      for (auto &r : ready)
+        FlushBatch(r.first, r.second);
+      ready.clear();
+
+      if (terminate)
+        break;
+
+      bool waiting = false;
+      std::chrono::time_point<std::chrono::steady_clock> wake_at;
+      for (int c = 0; c < n_classes; ++c) {
+        if (open[c].batch->samples.empty())
+          continue;
+        if (!waiting || open[c].flush_at < wake_at)
+          wake_at = open[c].flush_at;
+        waiting = true;
+      }
+
+      std::unique_lock<std::mutex> lock(mtx_former);
+      former_sleeping.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      auto wake = [this] {
+        return terminate || drain_pending || IngestPending();
+      };
+      if (!waiting)
+        cv_former.wait(lock, wake);
+      else
+        cv_former.wait_until(lock, wake_at, wake);
+
+      former_sleeping.store(false, std::memory_order_relaxed);
     }
+
+    // Partial batches still open on terminate were left by a Drain() that
+    // timed out, the devices are about to go so their samples are dropped
+    // rather than flushed. The batches go back to the pool either way.
+    uint64_t dropped = 0;
+    for (int c = 0; c < n_classes; ++c) {
+      dropped += open[c].batch->samples.size();
+      open[c].batch->release();
+    }
+    if (dropped > 0)
+      std::cout << "KILT dropped " << dropped
+                << " samples in partial batches at shutdown" << std::endl;
+
     std::cout << "KILT Scheduler terminating..." << std::endl;
   }
 
+  // Stamp a class batch as it receives its first samples.
+  void OpenClassBatch(int c, OpenBatch &b) {
+    b.opened = std::chrono::steady_clock::now();
+    if (c == 0 && batch_controller)
+      b.flush_at = b.opened +
+                   std::chrono::microseconds(batch_controller->update(b.opened));
+    else
+      b.flush_at = b.opened + classes[c].max_wait;
+    b.edf = b.opened + classes[c].deadline;
+  }
+
+  bool IngestPending() {
+    for (auto q : ingest_queues)
+      if (!q->empty())
+        return true;
+    return false;
+  }
+
   IConfig *config;
 
   int n_devices;
 
   std::vector<uint64_t> batch_trace;
-  std::vector<uint64_t> queue_len;
+  std::vector<std::atomic<int>> queue_len;
   std::vector<uint64_t> distribution;
 
   std::vector<IDevice<Sample> *> devices;
   std::vector<IDataSource *> data_sources;
 
+  // data source of each device, and the groups built from them
+  std::vector<int> device_data_source;
+  std::vector<DeviceGroup *> groups;
+  std::vector<DeviceGroup *> active_groups;
+
   IModel *model;
 
-  std::vector<Sample> samples_queue;
-  std::mutex mtx_samples_queue;
-  std::chrono::time_point<std::chrono::steady_clock> prev;
+  // lock-free ingest from any number of threads, one queue per class
+  std::vector<PriorityClass> classes;
+  std::vector<MPSCQueue<Sample> *> ingest_queues;
+  LatencyHistogram *class_latency;
+
+  // recycled batches, handed over by pointer all the way to the devices
+  BatchPool<Sample> *batch_pool;
+
+  std::mutex mtx_former;
+  std::condition_variable cv_former;
+  std::atomic<bool> former_sleeping;
+
+  std::chrono::microseconds max_wait;
+  AdaptiveBatchController *batch_controller;
+
+  // how far past its deadline each timed out batch was flushed
+  LatencyHistogram flush_lateness;
+
+  // preprocessing workers, each serving one group
+  std::atomic<bool> preprocess_terminate;
+  std::vector<PreprocessContext> preprocess_contexts;
+  std::vector<std::thread> preprocess_threads;
+
+  // per stage counters
+  LatencyHistogram batch_fill_time;
+  LatencyHistogram preprocess_queue_wait;
+  LatencyHistogram preprocess_time;
+  LatencyHistogram dispatch_time;
 
   std::atomic<bool> terminate;
   std::thread scheduler;
 
-  int scheduler_yield_time;
+  // drain state
+  std::atomic<bool> accepting;
+  std::atomic<bool> drain_pending;
+  bool drained;
+
+  // samples of an unknown priority class have been reported
+  std::atomic<bool> unknown_class_logged{false};
+
   int dispatch_yield_time;
+  IServerConfig::DISPATCH_POLICY dispatch_policy;
   
-  std::atomic<int32_t> completed_samples;
+  // sample accounting, completions are reported by the devices
+  std::atomic<uint64_t> submitted_samples;
+  std::atomic<uint64_t> completed_samples;
+  std::atomic<int> completion_waiters;
+  std::mutex mtx_completion;
+  std::condition_variable cv_completion;
 };
 
 #endif // KRAI_INFERENCE_LIBRARY_H
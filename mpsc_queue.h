@@ -0,0 +1,138 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace KRAI {
+
+#define KILT_CACHE_LINE_SIZE 64
+
+// Bounded lock-free multi-producer / single-consumer queue.
+//
+// Every cell carries a sequence number recording which lap of the ring it is
+// ready for. Producers claim a run of consecutive cells with a single CAS on
+// the tail, fill them and publish each cell by bumping its sequence; they
+// never wait for each other, only for the consumer when the ring is full.
+template <typename T> class MPSCQueue {
+public:
+  MPSCQueue(size_t min_capacity) {
+    capacity = 1;
+    while (capacity < min_capacity)
+      capacity <<= 1;
+    mask = capacity - 1;
+
+    cells.reset(new Cell[capacity]);
+    for (size_t i = 0; i < capacity; ++i)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+
+    tail.store(0, std::memory_order_relaxed);
+    head = 0;
+  }
+
+  // Enqueue count items, in order. Runs longer than the ring are split.
+  // Spins (yielding) only while the ring is full.
+  void push(const T *items, size_t count) {
+    while (count != 0) {
+      size_t n = count < capacity ? count : capacity;
+      size_t pos = tail.load(std::memory_order_relaxed);
+
+      while (true) {
+        // the consumer frees cells in order, so if the last cell of the run
+        // is free for this lap then all of them are.
+        size_t last = pos + n - 1;
+        size_t seq = cells[last & mask].seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)last;
+
+        if (diff == 0) {
+          if (tail.compare_exchange_weak(pos, pos + n,
+                                         std::memory_order_relaxed))
+            break;
+        } else if (diff < 0) {
+          // full - wait for the consumer
+          std::this_thread::yield();
+          pos = tail.load(std::memory_order_relaxed);
+        } else {
+          pos = tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      for (size_t i = 0; i < n; ++i) {
+        Cell &c = cells[(pos + i) & mask];
+        c.data = items[i];
+        c.seq.store(pos + i + 1, std::memory_order_release);
+      }
+
+      items += n;
+      count -= n;
+    }
+  }
+
+  void push(const T &item) { push(&item, 1); }
+
+  // Consumer only. Dequeue up to max items into out, returns the number
+  // dequeued.
+  size_t pop(T *out, size_t max) {
+    size_t n = 0;
+    while (n < max) {
+      Cell &c = cells[head & mask];
+      if (c.seq.load(std::memory_order_acquire) != head + 1)
+        break;
+      out[n++] = c.data;
+      c.seq.store(head + capacity, std::memory_order_release);
+      ++head;
+    }
+    return n;
+  }
+
+  // Consumer only.
+  bool empty() const {
+    return cells[head & mask].seq.load(std::memory_order_acquire) != head + 1;
+  }
+
+  size_t getCapacity() const { return capacity; }
+
+private:
+  struct alignas(KILT_CACHE_LINE_SIZE) Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  size_t capacity;
+  size_t mask;
+
+  alignas(KILT_CACHE_LINE_SIZE) std::atomic<size_t> tail;
+  alignas(KILT_CACHE_LINE_SIZE) size_t head;
+};
+
+} // namespace KRAI
+
+#endif // MPSC_QUEUE_H
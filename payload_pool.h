@@ -0,0 +1,141 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef PAYLOAD_POOL_H
+#define PAYLOAD_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "mpsc_queue.h"
+
+namespace KRAI {
+
+// Bounded lock-free stack of the indices 0..capacity-1 (a Treiber stack).
+//
+// The head packs the top index together with a tag that is bumped on every
+// update, so a pop that read a stale next link loses its CAS instead of
+// corrupting the stack (ABA). Any thread may push or pop.
+class IndexStack {
+public:
+  IndexStack(int capacity) : next(new std::atomic<int32_t>[capacity]) {
+    for (int i = 0; i < capacity; ++i)
+      next[i].store(-1, std::memory_order_relaxed);
+    head.store(pack(-1, 0), std::memory_order_relaxed);
+  }
+
+  void push(int idx) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    do {
+      next[idx].store(index(h), std::memory_order_relaxed);
+    } while (!head.compare_exchange_weak(h, pack(idx, tag(h) + 1),
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  // Returns -1 when empty.
+  int pop() {
+    uint64_t h = head.load(std::memory_order_acquire);
+    while (index(h) >= 0) {
+      int32_t n = next[index(h)].load(std::memory_order_relaxed);
+      if (head.compare_exchange_weak(h, pack(n, tag(h) + 1),
+                                     std::memory_order_acquire,
+                                     std::memory_order_acquire))
+        return index(h);
+    }
+    return -1;
+  }
+
+  bool empty() const {
+    return index(head.load(std::memory_order_acquire)) < 0;
+  }
+
+private:
+  static uint64_t pack(int32_t idx, uint32_t tag) {
+    return ((uint64_t)tag << 32) | (uint32_t)idx;
+  }
+  static int32_t index(uint64_t h) { return (int32_t)(uint32_t)h; }
+  static uint32_t tag(uint64_t h) { return h >> 32; }
+
+  std::unique_ptr<std::atomic<int32_t>[]> next;
+  alignas(KILT_CACHE_LINE_SIZE) std::atomic<uint64_t> head;
+};
+
+// One bit per activation, set while the activation has a free payload, so
+// the scheduler can find the next usable activation without probing every
+// ring buffer.
+class ActivationMask {
+public:
+  ActivationMask(int count)
+      : count(count), words((count + 63) / 64),
+        bits(new std::atomic<uint64_t>[(count + 63) / 64]) {
+    for (int w = 0; w < words; ++w)
+      bits[w].store(0, std::memory_order_relaxed);
+  }
+
+  void set(int a) {
+    std::atomic<uint64_t> &w = bits[a / 64];
+    uint64_t bit = (uint64_t)1 << (a % 64);
+    // Always a read-modify-write, never skipped after a plain load: a
+    // release that saw the bit still set just before the scheduler's
+    // clear() would otherwise leave its payload out of the mask while the
+    // scheduler's re-check missed the push. As RMWs on the word are
+    // ordered, either this lands after clear() or clear() sees the push.
+    w.fetch_or(bit, std::memory_order_seq_cst);
+  }
+
+  void clear(int a) {
+    bits[a / 64].fetch_and(~((uint64_t)1 << (a % 64)),
+                           std::memory_order_seq_cst);
+  }
+
+  // Next activation after `after` (wrapping round) with its bit set, or -1
+  // if there is none.
+  int next(int after) const {
+    int start = (after + 1) % count;
+    for (int i = 0; i <= words; ++i) {
+      int w = (start / 64 + i) % words;
+      uint64_t m = bits[w].load(std::memory_order_acquire);
+      // on the first word only look at or above the start position, the
+      // lower bits are picked up when we wrap back round to it
+      if (i == 0)
+        m &= ~(uint64_t)0 << (start % 64);
+      if (m) {
+        int a = w * 64 + __builtin_ctzll(m);
+        if (a < count)
+          return a;
+      }
+    }
+    return -1;
+  }
+
+private:
+  int count;
+  int words;
+  std::unique_ptr<std::atomic<uint64_t>[]> bits;
+};
+
+} // namespace KRAI
+
+#endif // PAYLOAD_POOL_H
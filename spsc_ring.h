@@ -0,0 +1,181 @@
+//
+// MIT License
+//
+// Copyright (c) 2024 Krai Ltd
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mpsc_queue.h"
+
+namespace KRAI {
+
+// Bounded lock-free single-producer / single-consumer ring.
+//
+// Slots are preallocated and indices only ever grow; the producer publishes
+// a slot with a release store of the tail and the consumer frees it with a
+// release store of the head, so the slot contents are ordered against the
+// index the other side reads. Each side caches the other's index and only
+// reloads it when the ring looks full (or empty).
+//
+// The consumer can block in wait() instead of polling. The producer then
+// wakes it through a futex, but only pays for the syscall when the consumer
+// is actually asleep.
+template <typename T> class SPSCRing {
+public:
+  SPSCRing(size_t _depth) {
+    depth = _depth;
+    size_t capacity = 1;
+    while (capacity < depth)
+      capacity <<= 1;
+    mask = capacity - 1;
+    slots.reset(new T[capacity]);
+  }
+
+  // Producer only. Returns false, leaving the ring unchanged, when full.
+  bool push(const T &item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - cached_head >= depth) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (t - cached_head >= depth)
+        return false;
+    }
+
+    slots[t & mask] = item;
+    tail.store(t + 1, std::memory_order_release);
+
+    // pairs with the fence in wait(): either the consumer sees the new tail
+    // or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed))
+      wake();
+
+    return true;
+  }
+
+  // Consumer only. Returns false when empty.
+  bool pop(T &item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (h == cached_tail)
+        return false;
+    }
+
+    item = slots[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Spins for up to spin_us, then sleeps for up to
+  // timeout_us (forever if negative) until the ring is non-empty or wake()
+  // is called. Returns whether there is something to pop.
+  bool wait(int64_t timeout_us, int64_t spin_us = 0) {
+    if (!empty())
+      return true;
+
+    if (spin_us > 0) {
+      auto until =
+          std::chrono::steady_clock::now() + std::chrono::microseconds(spin_us);
+      while (std::chrono::steady_clock::now() < until)
+        if (!empty())
+          return true;
+    }
+
+    uint32_t e = epoch.load(std::memory_order_acquire);
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (empty()) {
+      struct timespec ts, *pts = nullptr;
+      if (timeout_us >= 0) {
+        ts.tv_sec = timeout_us / 1000000;
+        ts.tv_nsec = (timeout_us % 1000000) * 1000;
+        pts = &ts;
+      }
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch),
+              FUTEX_WAIT_PRIVATE, e, pts, nullptr, 0);
+    }
+
+    sleeping.store(false, std::memory_order_relaxed);
+    return !empty();
+  }
+
+  // Wakes a consumer blocked in wait(), e.g. to let it see a terminate flag.
+  void wake() {
+    epoch.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch), FUTEX_WAKE_PRIVATE,
+            1, nullptr, nullptr, 0);
+  }
+
+  // Consumer only.
+  bool empty() {
+    if (head.load(std::memory_order_relaxed) != cached_tail)
+      return false;
+    cached_tail = tail.load(std::memory_order_acquire);
+    return head.load(std::memory_order_relaxed) == cached_tail;
+  }
+
+  // Free slots, exact on the producer thread. Anywhere else it is only a
+  // hint: the two indices are read at different times, so the result is
+  // clamped to [0, depth] and may already be stale when returned.
+  int getFreeSlots() const {
+    size_t h = head.load(std::memory_order_acquire);
+    size_t t = tail.load(std::memory_order_acquire);
+    if (t <= h)
+      return depth;
+    return t - h >= depth ? 0 : depth - (t - h);
+  }
+
+  size_t getDepth() const { return depth; }
+
+private:
+  std::unique_ptr<T[]> slots;
+  size_t depth;
+  size_t mask;
+
+  // producer side
+  alignas(KILT_CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+  size_t cached_head = 0;
+
+  // consumer side
+  alignas(KILT_CACHE_LINE_SIZE) std::atomic<size_t> head{0};
+  size_t cached_tail = 0;
+  std::atomic<bool> sleeping{false};
+
+  alignas(KILT_CACHE_LINE_SIZE) std::atomic<uint32_t> epoch{0};
+};
+
+} // namespace KRAI
+
+#endif // SPSC_RING_H